@@ -8,77 +8,185 @@
 BlockHandler::BlockHandler() {}
 BlockHandler::~BlockHandler() {}
 
-[[noreturn]] void BlockHandler::generate_block(Block *current, bool *lock) {
-    begin:{};
+BlockConfig BlockConfig::from_env() {
+    BlockConfig config{};
+    config.block_time = std::chrono::milliseconds(unit::env_u64("UNIT_BLOCK_TIME_MS", BLOCK_TIME_MS));
+    config.min_block_time = std::chrono::milliseconds(unit::env_u64("UNIT_BLOCK_MIN_TIME_MS", BLOCK_MIN_TIME_MS));
+    config.max_idle_time = std::chrono::milliseconds(unit::env_u64("UNIT_BLOCK_MAX_IDLE_MS", BLOCK_MAX_IDLE_MS));
+    config.max_txs = unit::env_u64("UNIT_BLOCK_MAX_TXS", BLOCK_MAX_TXS);
+    config.max_bytes = unit::env_u64("UNIT_BLOCK_MAX_BYTES", BLOCK_MAX_BYTES);
+    config.adaptive = unit::env_bool("UNIT_BLOCK_ADAPTIVE", false);
+    if (config.min_block_time > config.block_time)
+        config.min_block_time = config.block_time;
+    if (config.max_idle_time < config.block_time)
+        config.max_idle_time = config.block_time;
+    return config;
+}
+
+void BlockHandler::wait_for_block(Mempool *mempool, const BlockConfig *config) {
+    auto started = std::chrono::steady_clock::now();
+    if (!config->adaptive) {
+        std::this_thread::sleep_until(started + config->block_time);
+        return;
+    }
+    std::this_thread::sleep_until(started + config->min_block_time);
+    // seal early once a full block is waiting
+    mempool->wait_until_ready(config->max_txs, config->max_bytes, started + config->block_time);
+    // nothing ready to include: stretch the interval, an empty block is still produced after max_idle_time
+    mempool->wait_until_ready(1, 1, started + config->max_idle_time);
+}
+
+uint64_t BlockHandler::read_block_height() {
+    std::optional<std::string> op_block_height = unit::DB::get_block_height();
+    std::string block_index = (op_block_height.has_value()) ? op_block_height.value() : R"({"index": 0})";
+    boost::json::value block_json = boost::json::parse(block_index);
+    return boost::json::value_to<uint64_t>(block_json.at("index"));
+}
+
+uint64_t BlockHandler::predict_next_index() {
+    std::lock_guard<std::mutex> lock(this->tip_mutex);
+    return this->committed_height + ++this->blocks_in_flight;
+}
+
+void BlockHandler::finish_block(uint64_t index, bool committed) {
+    std::lock_guard<std::mutex> lock(this->tip_mutex);
+    this->blocks_in_flight--;
+    if (committed)
+        this->committed_height = index;
+}
+
+[[noreturn]] void BlockHandler::generate_block() {
     std::cout << "Starting 'block generator'" << std::endl;
     loop: {
-        *current = Block(1);
-        std::this_thread::sleep_for(std::chrono::milliseconds( 5000)); // 1000 millisecond * 5 = 5 seconds
-        *lock = true;
-
-        std::optional<std::string> op_block_height = unit::DB::get_block_height();
-        std::string block_index = (op_block_height.has_value()) ? op_block_height.value() : R"({"index": 0})";
-        boost::json::value block_json = boost::json::parse(block_index);
-        uint64_t index = boost::json::value_to<uint64_t>(block_json.at("index")) + 1;
-        current->setIndex(index);
+        Block current = Block(BLOCK_NET_VERSION);
+        wait_for_block(&this->mempool, &this->config);
+        uint64_t index = predict_next_index();
+        current.setIndex(index);
 
         if(index == 1){
-            boost::json::value extra = boost::json::value_from(R"({"name":"unit", "value":"null", "bytecode":"null"})");
-            Transaction tx = Transaction("genesis", "g2px1", 0,  extra, "0", 350000);
-            Transaction tx1 = Transaction("genesis", "teo", 0,  extra, "0", 350000);
-            Transaction tx2 = Transaction("genesis", "sunaked", 0,  extra, "0", 350000);
-            Transaction tx3 = Transaction("genesis", "merchant", 0,  extra, "0", 350000);
-            tx.generate_tx_hash();
-            tx1.generate_tx_hash();
-            tx2.generate_tx_hash();
-            tx3.generate_tx_hash();
-            current->setTransactions({tx, tx1, tx2, tx3});
+            unit::TxPayload extra;
+            extra.set(unit::TxPayload::NAME, "unit");
+            extra.set(unit::TxPayload::VALUE, "null");
+            extra.set(unit::TxPayload::BYTECODE, "null");
+            for (const char *address : {"g2px1", "teo", "sunaked", "merchant"}) {
+                Transaction tx = Transaction("genesis", address, 0,  extra, "0", 350000);
+                tx.generate_tx_hash();
+                current.push_tx(tx);
+            }
+        } else {
+            this->mempool.evict_expired();
+            current.transactions = this->mempool.pop_best(this->config.max_txs, this->config.max_bytes); // highest fee rate first
+        }
+
+        this->sealed_blocks.push(std::move(current)); // waits while the commit thread is behind
+        goto loop;
+    };
+}
+
+void BlockHandler::commit_blocks() {
+    std::cout << "Starting 'block committer'" << std::endl;
+    Block current;
+    while (this->sealed_blocks.pop(current)) {
+        {
+            std::lock_guard<std::mutex> lock(this->tip_mutex);
+            if (current.getIndex() != this->committed_height + 1) { // an earlier block failed to commit
+                std::cout << "Error: block #" << current.getIndex() << " was predicted on a stale tip, committing it as #" << this->committed_height + 1 << std::endl;
+                current.setIndex(this->committed_height + 1);
+            }
         }
 
-        if(!current->transactions.empty()) {
+        std::vector<unit::Hash32> taken_hashes; // taken out of the pool whatever happens to the block, journaled as removed
+        taken_hashes.reserve(current.transactions.size());
+        for (const Transaction &transaction : current.transactions)
+            taken_hashes.push_back(transaction.hash);
+
+        std::vector<Mempool::Included> included;
+        included.reserve(current.transactions.size());
+        for (const Transaction &transaction : current.transactions)
+            included.push_back(Mempool::Included{transaction.from, transaction.nonce, false});
+
+        if(!current.transactions.empty()) {
+            bool applied;
             try {
-                unit::DB::push_transactions(current);
+                applied = unit::DB::push_transactions(&current);
             } catch (std::exception &e) {
                 std::cout << "Error: " << e.what() << std::endl;
-                goto begin;
+                applied = false;
+            }
+            if (!applied) { // nothing of the block was written
+                std::cout << "Error: block #" << current.getIndex() << " was not applied, its transactions are dropped" << std::endl;
+                this->journal.remove(taken_hashes);
+                this->mempool.block_committed(included);
+                this->subscriptions.block_failed(taken_hashes);
+                finish_block(current.getIndex(), false);
+                continue;
+            }
+        }
+        // rejected transactions were compacted out of the block, the rest of the sender's sequence waits for a resend
+        for (std::size_t i = 0, j = 0; i < included.size() && j < current.transactions.size(); ++i) {
+            if (taken_hashes[i] == current.transactions[j].hash) {
+                included[i].executed = true;
+                j++;
             }
         }
 
-        current->generate_hash();
-        unit::DB::push_block(*current);
-        *lock = false;
-        goto loop;
-    };
+        current.generate_hash();
+        unit::DB::push_block(current);
+        this->journal.remove(taken_hashes);
+        this->mempool.block_committed(included);
+        this->subscriptions.block_committed(current, taken_hashes);
+        finish_block(current.getIndex(), true);
+    }
 }
 
 [[noreturn]] void BlockHandler::run() {
-    std::thread th(BlockHandler::generate_block, &currentblock, &block_lock);
+    unit::DB::create_missing_column_families();
+    unit::DB::load_addresses();
+    // restore transactions accepted before the last shutdown, before the server starts taking new ones
+    if (unit::env_bool("UNIT_MEMPOOL_JOURNAL", true)) {
+        try {
+            std::vector<unit::Hash32> dropped; // committed meanwhile, replaced or over the budget now
+            for (Transaction &transaction : journal.replay()) {
+                std::string from = transaction.from;
+                std::optional<std::string> balance = unit::DB::get_balance(from);
+                uint64_t account_nonce = balance.has_value() ? WalletAccount::getNonce(boost::json::parse(balance.value())) : 0;
+                unit::Hash32 hash = transaction.hash;
+                Mempool::InsertResult result = mempool.insert(std::move(transaction), account_nonce);
+                if (result != Mempool::ADDED && result != Mempool::REPLACED)
+                    dropped.push_back(hash);
+            }
+            journal.remove(dropped);
+            mempool.attach_journal(&journal);
+        } catch (std::exception &e) {
+            std::cout << "Error: mempool journal is disabled: " << e.what() << std::endl;
+        }
+    }
+
+    committed_height = read_block_height();
+    std::thread commit_th(&BlockHandler::commit_blocks, this);
+    commit_th.detach();
+    std::thread th(&BlockHandler::generate_block, this);
     th.detach();
-    std::thread server_th(Server::start_server, &transactions_deque);
+    pipeline.start();
+    std::thread server_th(Server::start_server, &pipeline, &mempool, &subscriptions);
     server_th.detach();
 
+    std::vector<ValidationPipeline::Submission> batch;
+    batch.reserve(INGEST_BATCH);
+
     loop: {
-        if (this->transactions_deque.empty())
+        if (this->transactions_deque.empty()) {
+            std::this_thread::yield();
             goto loop;
-        else
-            goto push_into_block;
+        }
+        goto push_into_mempool;
     };
 
-    push_into_block: {
-        if(block_lock) goto loop;
-        try {
-            if(currentblock.transactions.size() >= 100) goto loop;
-            Transaction transaction = Transaction(this->transactions_deque.front());
-            currentblock.push_tx(transaction);
-        } catch (std::exception &e) {
-            std::cout << e.what() << std::endl;
-            goto loop;
-        }
-        try {
-            this->transactions_deque.erase(this->transactions_deque.begin());
-        } catch (std::exception &e) {
-            std::cout << e.what() << std::endl;
-        }
+    push_into_mempool: {
+        batch.clear();
+        this->transactions_deque.pop_batch(batch, INGEST_BATCH);
+        for (ValidationPipeline::Submission &submission : batch)
+            this->pipeline.admit(submission);
         goto loop;
     };
 }
\ No newline at end of file
@@ -14,8 +14,36 @@
 #include "boost/json.hpp"
 #include "Blockchain_core/Transaction.h"
 #include "Blockchain_core/DB/DB.h"
+#include "Blockchain_core/Mempool/Mempool.h"
+#include "Blockchain_core/Mempool/ValidationPipeline.h"
 #include "Server/Server.h"
-#include "containers/list.h"
+#include "containers/mpsc_queue.h"
+#include "containers/bounded_queue.h"
+#include "ENV/env.h"
+
+#define TX_QUEUE_CAPACITY 65536 // validated transactions waiting to be moved into the mempool
+#define INGEST_BATCH 256 // transactions moved from the queue into the mempool at once
+#define BLOCK_TIME_MS 5000
+#define BLOCK_MIN_TIME_MS 250
+#define BLOCK_MAX_IDLE_MS 60000
+#define BLOCK_MAX_TXS 100
+#define BLOCK_MAX_BYTES (4 * 1024 * 1024)
+#define BLOCK_PIPELINE_DEPTH 1 // sealed blocks waiting for the commit thread
+#define BLOCK_NET_VERSION MERKLE_FLAT_NET_VERSION // version of produced blocks
+
+// Block production limits. In adaptive mode a block is sealed as soon as the mempool holds a full block
+// (but not earlier than min_block_time), and when the mempool is empty the interval is stretched up to
+// max_idle_time instead of producing empty blocks.
+struct BlockConfig {
+    std::chrono::milliseconds block_time;
+    std::chrono::milliseconds min_block_time;
+    std::chrono::milliseconds max_idle_time;
+    std::size_t max_txs;
+    std::size_t max_bytes;
+    bool adaptive;
+
+    static BlockConfig from_env();
+};
 
 class BlockHandler {
 public:
@@ -25,11 +53,25 @@ public:
     [[noreturn]] void run();
 
 private:
-    unit::list<Transaction> transactions_deque;
-    Block currentblock = Block(1);
-    bool block_lock = false;
+    unit::mpsc_queue<ValidationPipeline::Submission> transactions_deque = unit::mpsc_queue<ValidationPipeline::Submission>(unit::env_u64("UNIT_TX_QUEUE_CAPACITY", TX_QUEUE_CAPACITY));
+    Mempool mempool;
+    ValidationPipeline pipeline{&mempool, &transactions_deque};
+    MempoolJournal journal;
+    Subscriptions subscriptions;
+    BlockConfig config = BlockConfig::from_env();
+    // Block N is executed, hashed and persisted by the commit thread while block N+1 is being filled.
+    // The producer predicts the height of the next block from the committed tip plus blocks still in flight.
+    unit::bounded_queue<Block> sealed_blocks = unit::bounded_queue<Block>(BLOCK_PIPELINE_DEPTH);
+    std::mutex tip_mutex;
+    uint64_t committed_height = 0;
+    uint64_t blocks_in_flight = 0;
 
-    [[noreturn]] static void generate_block(Block *current, bool *lock);
+    [[noreturn]] void generate_block();
+    void commit_blocks();
+    uint64_t predict_next_index();
+    void finish_block(uint64_t index, bool committed);
+    static uint64_t read_block_height();
+    static void wait_for_block(Mempool *mempool, const BlockConfig *config);
 };
 
 
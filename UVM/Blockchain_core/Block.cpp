@@ -16,7 +16,7 @@
 
 std::ostream &operator<<(std::ostream &out, const Block &block) {
     std::string all_tx_to_string;
-    for (Transaction tx : block.transactions) {
+    for (const Transaction &tx : block.transactions) {
         if (tx == block.transactions[block.transactions.size()-1]) {
             all_tx_to_string.append(tx.to_string());
             break;
@@ -35,20 +35,43 @@ std::string Block::to_string() {
 }
 
 void Block::generate_hash() {
+    if (this->transactions.empty() && this->net_version >= MERKLE_FLAT_NET_VERSION) {
+        std::string header;
+        unit::Encoder encoder(&header);
+        this->encode_header(encoder);
+        unit::Hash32 header_hash;
+        sha3.reset();
+        sha3.add(header.data(), header.size());
+        sha3.getHash(header_hash.data());
+        sha3.reset();
+        sha3.add(header_hash.data(), header_hash.size());
+        sha3.getHash(this->hash.data());
+        return;
+    }
     if (this->transactions.empty()) {
         std::ostringstream string_stream;
-        string_stream << R"({"index":)" << this->index << R"({, "prev_hash":")" << this->prev_hash << R"({", "timestamp":)" << this->date << "}";
+        string_stream << R"({"index":)" << this->index << R"({, "prev_hash":")" << (this->prev_hash.is_zero() ? "genesis" : this->prev_hash.to_hex()) << R"({", "timestamp":)" << this->date << "}";
         std::string doubled_hash = sha3(sha3(string_stream.str()));
-        this->hash = "0x" + doubled_hash;
+        this->hash = unit::Hash32::from_hex("0x" + doubled_hash).value();
         return;
     }
 
-    std::vector<std::string> leafs(this->transactions.size());
-    for (const Transaction& tx : this->transactions) {
-        leafs.emplace_back(tx.hash);
+    if (this->net_version < MERKLE_FLAT_NET_VERSION) {
+        // reproduces old blocks exactly, including the empty leaves in front of the transaction hashes
+        std::vector<std::string> leafs(this->transactions.size());
+        for (const Transaction& tx : this->transactions) {
+            leafs.emplace_back(tx.hash.to_hex());
+        }
+        this->hash = unit::Hash32::from_hex(MerkleTree::legacy_root(leafs)).value();
+        return;
     }
 
-    MerkleTree merkleTree = MerkleTree(leafs);
+    std::vector<MerkleTree::Digest> leaves;
+    leaves.reserve(this->transactions.size());
+    for (const Transaction &tx : this->transactions)
+        leaves.push_back(tx.hash);
+
+    MerkleTree merkleTree = MerkleTree(std::move(leaves));
     this->hash = merkleTree.get_root().value(); // it's guaranteed here that tree has root because transaction's vector is always !empty.
 }
 
@@ -76,19 +99,19 @@ void Block::setNetVersion(uint16_t netVersion) {
    this->net_version = netVersion;
 }
 
-const std::string &Block::getHash() const {
+const unit::Hash32 &Block::getHash() const {
     return hash;
 }
 
-void Block::setHash(const std::string &hash) {
+void Block::setHash(const unit::Hash32 &hash) {
     Block::hash = hash;
 }
 
-const std::string &Block::getPrevHash() const {
+const unit::Hash32 &Block::getPrevHash() const {
     return prev_hash;
 }
 
-void Block::setPrevHash(const std::string &prevHash) {
+void Block::setPrevHash(const unit::Hash32 &prevHash) {
     prev_hash = prevHash;
 }
 
@@ -96,24 +119,23 @@ const std::vector<Transaction> &Block::getTransactions() const {
     return transactions;
 }
 
-void Block::setTransactions(const std::vector<Transaction> &transactions) {
-    Block::transactions = transactions;
+void Block::setTransactions(std::vector<Transaction> transactions) {
+    Block::transactions = std::move(transactions);
 }
 
 void Block::push_tx(Transaction &tx) {
     this->transactions.emplace_back(std::move(tx));
 }
 
-Block::Block(uint64_t index, uint16_t netVersion, const std::string &prevHash,
-             const std::vector<Transaction> &transactions) : index(index), net_version(netVersion), prev_hash(prevHash),
-                                                             transactions(transactions) {
+Block::Block(uint64_t index, uint16_t netVersion, const unit::Hash32 &prevHash,
+             std::vector<Transaction> transactions) : index(index), net_version(netVersion), prev_hash(prevHash),
+                                                             transactions(std::move(transactions)) {
     this->index = index;
     this->net_version = netVersion;
     this->prev_hash = prevHash;
-    this->transactions = transactions;
 }
 
-Block::Block(uint64_t index, uint16_t netVersion, const std::string &prevHash) : index(index), net_version(netVersion),
+Block::Block(uint64_t index, uint16_t netVersion, const unit::Hash32 &prevHash) : index(index), net_version(netVersion),
                                                                                  prev_hash(prevHash) {
     this->index = index;
     this->net_version = netVersion;
@@ -124,7 +146,7 @@ void Block::set_current_date() {
     this->date = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 }
 
-Block::Block(uint64_t date, uint64_t index, uint16_t netVersion, const std::string &prevHash) : date(date),
+Block::Block(uint64_t date, uint64_t index, uint16_t netVersion, const unit::Hash32 &prevHash) : date(date),
                                                                                                 index(index),
                                                                                                 net_version(netVersion),
                                                                                                 prev_hash(prevHash) {
@@ -134,31 +156,29 @@ Block::Block(uint64_t date, uint64_t index, uint16_t netVersion, const std::stri
     this->prev_hash = prevHash;
 }
 
-Block::Block(uint64_t date, uint64_t index, uint16_t netVersion, const std::string &prevHash,
-             const std::vector<Transaction> &transactions) : date(date), index(index), net_version(netVersion),
-                                                             prev_hash(prevHash), transactions(transactions) {
+Block::Block(uint64_t date, uint64_t index, uint16_t netVersion, const unit::Hash32 &prevHash,
+             std::vector<Transaction> transactions) : date(date), index(index), net_version(netVersion),
+                                                             prev_hash(prevHash), transactions(std::move(transactions)) {
     this->date = date;
     this->index = index;
     this->net_version = netVersion;
     this->prev_hash = prevHash;
-    this->transactions = transactions;
 }
 
-Block::Block(uint64_t date, uint64_t index, uint16_t netVersion, const std::string &hash, const std::string &prevHash,
-             const std::vector<Transaction> &transactions) : date(date), index(index), net_version(netVersion),
+Block::Block(uint64_t date, uint64_t index, uint16_t netVersion, const unit::Hash32 &hash, const unit::Hash32 &prevHash,
+             std::vector<Transaction> transactions) : date(date), index(index), net_version(netVersion),
                                                              hash(hash), prev_hash(prevHash),
-                                                             transactions(transactions) {
+                                                             transactions(std::move(transactions)) {
     this->date = date;
     this->index = index;
     this->net_version = netVersion;
     this->hash = hash;
     this->prev_hash = prevHash;
-    this->transactions = transactions;
 }
 
 std::string Block::to_json_string() {
     std::string all_tx_to_json_string;
-    for (Transaction tx : this->transactions) {
+    for (const Transaction &tx : this->transactions) {
         if (tx == this->transactions[this->transactions.size()-1]) {
             all_tx_to_json_string.append(tx.to_json_string());
             break;
@@ -172,12 +192,12 @@ std::string Block::to_json_string() {
 
 std::string Block::to_json_with_tx_hash_only() {
     std::string all_tx_to_json_string;
-    for (Transaction tx : this->transactions) {
+    for (const Transaction &tx : this->transactions) {
         if (tx == this->transactions[this->transactions.size()-1]) {
-            all_tx_to_json_string.append("\"").append(tx.hash).append("\"");
+            all_tx_to_json_string.append("\"").append(tx.hash.to_hex()).append("\"");
             break;
         }
-        all_tx_to_json_string.append("\"").append(tx.hash).append("\", ");
+        all_tx_to_json_string.append("\"").append(tx.hash.to_hex()).append("\", ");
     }
     std::ostringstream string_stream;
     string_stream << R"({"hash":")" << this->hash << R"(", "prev_hash":")" << this->prev_hash << R"(", "net_version":")" << this->net_version << R"(", "index":)" << this->index << R"(, "date":)" << this->date << R"(, "transactions": [)" << all_tx_to_json_string <<"]}";
@@ -188,4 +208,43 @@ Block::Block(uint16_t netVersion) : net_version(netVersion) {
     this->net_version = netVersion;
 }
 
-
+void Block::encode_header(unit::Encoder &encoder) const {
+    encoder.u8(CODEC_BLOCK_VERSION);
+    encoder.u16(this->net_version);
+    encoder.u64(this->index);
+    encoder.u64(this->date);
+    encoder.hash(this->prev_hash);
+}
+
+std::string Block::encode() const {
+    std::size_t size = 1 + 2 + 8 + 8 + 2 * unit::Hash32::SIZE + 4 + this->transactions.size() * unit::Hash32::SIZE;
+    std::string encoded;
+    encoded.reserve(size);
+    unit::Encoder encoder(&encoded);
+    this->encode_header(encoder);
+    encoder.hash(this->hash);
+    encoder.u32(static_cast<uint32_t>(this->transactions.size()));
+    for (const Transaction &tx : this->transactions)
+        encoder.hash(tx.hash);
+    return encoded;
+}
+
+Block Block::decode(const std::string &encoded) {
+    unit::Decoder decoder(encoded);
+    uint8_t version = decoder.u8();
+    if (version != CODEC_BLOCK_VERSION)
+        throw std::runtime_error("codec: unknown block version " + std::to_string(version));
+    Block block;
+    block.net_version = decoder.u16();
+    block.index = decoder.u64();
+    block.date = decoder.u64();
+    block.prev_hash = decoder.hash();
+    block.hash = decoder.hash();
+    uint32_t count = decoder.u32();
+    block.transactions.reserve(std::min<std::size_t>(count, encoded.size() / 4)); // every hash takes 4 bytes at least
+    for (uint32_t i = 0; i < count; ++i) {
+        block.transactions.emplace_back();
+        block.transactions.back().hash = decoder.hash();
+    }
+    return block;
+}
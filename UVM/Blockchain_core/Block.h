@@ -19,20 +19,24 @@ public:
 
     virtual ~Block();
     Block(uint16_t netVersion);
-    Block(uint64_t index, uint16_t netVersion, const std::string &prevHash,
-          const std::vector<Transaction> &transactions);
-    Block(uint64_t index, uint16_t netVersion, const std::string &prevHash);
-    Block(uint64_t date, uint64_t index, uint16_t netVersion, const std::string &prevHash);
-    Block(uint64_t date, uint64_t index, uint16_t netVersion, const std::string &prevHash,
-          const std::vector<Transaction> &transactions);
-    Block(uint64_t date, uint64_t index, uint16_t netVersion, const std::string &hash, const std::string &prevHash,
-          const std::vector<Transaction> &transactions);
+    Block(uint64_t index, uint16_t netVersion, const unit::Hash32 &prevHash,
+          std::vector<Transaction> transactions);
+    Block(uint64_t index, uint16_t netVersion, const unit::Hash32 &prevHash);
+    Block(uint64_t date, uint64_t index, uint16_t netVersion, const unit::Hash32 &prevHash);
+    Block(uint64_t date, uint64_t index, uint16_t netVersion, const unit::Hash32 &prevHash,
+          std::vector<Transaction> transactions);
+    Block(uint64_t date, uint64_t index, uint16_t netVersion, const unit::Hash32 &hash, const unit::Hash32 &prevHash,
+          std::vector<Transaction> transactions);
+    Block(const Block &block) = delete; // transactions are move-only
+    Block(Block &&block) noexcept = default;
+    Block &operator=(const Block &block) = delete;
+    Block &operator=(Block &&block) noexcept = default;
 
     uint64_t date = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
     uint64_t index;
     uint16_t net_version = 1;
-    std::string hash;
-    std::string prev_hash;
+    unit::Hash32 hash;
+    unit::Hash32 prev_hash; // zero for the genesis block
     std::vector<Transaction> transactions;
     long block_size = 0;
 
@@ -46,16 +50,20 @@ public:
     void setIndex(uint64_t index);
     [[nodiscard]] uint16_t getNetVersion() const;
     void setNetVersion(uint16_t netVersion);
-    [[nodiscard]] const std::string &getHash() const;
-    void setHash(const std::string &hash);
-    [[nodiscard]] const std::string &getPrevHash() const;
-    void setPrevHash(const std::string &prevHash);
+    [[nodiscard]] const unit::Hash32 &getHash() const;
+    void setHash(const unit::Hash32 &hash);
+    [[nodiscard]] const unit::Hash32 &getPrevHash() const;
+    void setPrevHash(const unit::Hash32 &prevHash);
     [[nodiscard]] const std::vector<Transaction> &getTransactions() const;
-    void setTransactions(const std::vector<Transaction> &transactions);
+    void setTransactions(std::vector<Transaction> transactions);
     friend std::ostream& operator<< (std::ostream &out, const Block &block);
     std::string to_string();
     std::string to_json_string();
     std::string to_json_with_tx_hash_only();
+    //  binary encoding (Codec/Codec.h): header and transaction hashes, as blocks are stored
+    void encode_header(unit::Encoder &encoder) const; // hashed for blocks without transactions
+    [[nodiscard]] std::string encode() const;
+    static Block decode(const std::string &encoded); // transactions only have their hashes
     inline void increase_block_size(long tx_size) {
         this->block_size += tx_size;
     }
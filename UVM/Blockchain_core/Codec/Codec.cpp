@@ -0,0 +1,230 @@
+#include "Codec.h"
+#include "algorithm"
+#include "cmath"
+#include "cstring"
+#include "vector"
+
+#define CODEC_MAX_JSON_DEPTH 64
+
+void unit::Encoder::u8(uint8_t value) {
+    this->out->push_back(static_cast<char>(value));
+}
+
+void unit::Encoder::u16(uint16_t value) {
+    for (int i = 0; i < 2; ++i)
+        this->out->push_back(static_cast<char>(value >> (8 * i)));
+}
+
+void unit::Encoder::u32(uint32_t value) {
+    for (int i = 0; i < 4; ++i)
+        this->out->push_back(static_cast<char>(value >> (8 * i)));
+}
+
+void unit::Encoder::u64(uint64_t value) {
+    for (int i = 0; i < 8; ++i)
+        this->out->push_back(static_cast<char>(value >> (8 * i)));
+}
+
+void unit::Encoder::f64(double value) {
+    uint64_t bits = 0;
+    if (std::isnan(value))
+        bits = 0x7ff8000000000000ULL;
+    else if (value != 0) // -0 and 0 are the same number
+        std::memcpy(&bits, &value, sizeof(bits));
+    u64(bits);
+}
+
+void unit::Encoder::bytes(const std::string &value) {
+    u32(static_cast<uint32_t>(value.size()));
+    this->out->append(value);
+}
+
+void unit::Encoder::hash(const Hash32 &value) {
+    this->out->append(value.view());
+}
+
+void unit::Encoder::json(const boost::json::value &value) {
+    switch (value.kind()) {
+        case boost::json::kind::null:
+            u8(TAG_NULL);
+            break;
+        case boost::json::kind::bool_:
+            u8(value.as_bool() ? TAG_TRUE : TAG_FALSE);
+            break;
+        case boost::json::kind::int64:
+            u8(TAG_INT64);
+            u64(static_cast<uint64_t>(value.as_int64()));
+            break;
+        case boost::json::kind::uint64:
+            u8(TAG_UINT64);
+            u64(value.as_uint64());
+            break;
+        case boost::json::kind::double_:
+            u8(TAG_DOUBLE);
+            f64(value.as_double());
+            break;
+        case boost::json::kind::string:
+            u8(TAG_STRING);
+            u32(static_cast<uint32_t>(value.as_string().size()));
+            this->out->append(value.as_string().data(), value.as_string().size());
+            break;
+        case boost::json::kind::array:
+            u8(TAG_ARRAY);
+            u32(static_cast<uint32_t>(value.as_array().size()));
+            for (const boost::json::value &item : value.as_array())
+                json(item);
+            break;
+        case boost::json::kind::object: {
+            const boost::json::object &object = value.as_object();
+            std::vector<const boost::json::key_value_pair *> members;
+            members.reserve(object.size());
+            for (const auto &member : object)
+                members.push_back(&member);
+            std::sort(members.begin(), members.end(), [](const boost::json::key_value_pair *a, const boost::json::key_value_pair *b) {
+                return a->key() < b->key();
+            });
+            u8(TAG_OBJECT);
+            u32(static_cast<uint32_t>(members.size()));
+            for (const boost::json::key_value_pair *member : members) {
+                u32(static_cast<uint32_t>(member->key().size()));
+                this->out->append(member->key().data(), member->key().size());
+                json(member->value());
+            }
+            break;
+        }
+    }
+}
+
+std::size_t unit::Encoder::json_size(const boost::json::value &value) {
+    switch (value.kind()) {
+        case boost::json::kind::int64:
+        case boost::json::kind::uint64:
+        case boost::json::kind::double_:
+            return 1 + 8;
+        case boost::json::kind::string:
+            return 1 + 4 + value.as_string().size();
+        case boost::json::kind::array: {
+            std::size_t size = 1 + 4;
+            for (const boost::json::value &item : value.as_array())
+                size += json_size(item);
+            return size;
+        }
+        case boost::json::kind::object: {
+            std::size_t size = 1 + 4;
+            for (const auto &member : value.as_object())
+                size += 4 + member.key().size() + json_size(member.value());
+            return size;
+        }
+        default:
+            return 1;
+    }
+}
+
+const char *unit::Decoder::take(std::size_t count) {
+    if (count > this->size - this->position)
+        throw std::runtime_error("codec: unexpected end of data");
+    const char *at = this->data + this->position;
+    this->position += count;
+    return at;
+}
+
+uint8_t unit::Decoder::u8() {
+    return static_cast<uint8_t>(*take(1));
+}
+
+uint8_t unit::Decoder::peek() const {
+    if (this->position == this->size)
+        throw std::runtime_error("codec: unexpected end of data");
+    return static_cast<uint8_t>(this->data[this->position]);
+}
+
+uint16_t unit::Decoder::u16() {
+    const char *at = take(2);
+    uint16_t value = 0;
+    for (int i = 0; i < 2; ++i)
+        value |= static_cast<uint16_t>(static_cast<unsigned char>(at[i])) << (8 * i);
+    return value;
+}
+
+uint32_t unit::Decoder::u32() {
+    const char *at = take(4);
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i)
+        value |= static_cast<uint32_t>(static_cast<unsigned char>(at[i])) << (8 * i);
+    return value;
+}
+
+uint64_t unit::Decoder::u64() {
+    const char *at = take(8);
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i)
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(at[i])) << (8 * i);
+    return value;
+}
+
+double unit::Decoder::f64() {
+    uint64_t bits = u64();
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+std::string unit::Decoder::bytes() {
+    uint32_t length = u32();
+    const char *at = take(length);
+    return std::string(at, length);
+}
+
+unit::Decoder unit::Decoder::frame(std::size_t count) {
+    const char *at = take(count);
+    return Decoder(at, count);
+}
+
+unit::Hash32 unit::Decoder::hash() {
+    return Hash32::from_bytes(std::string_view(take(Hash32::SIZE), Hash32::SIZE)).value();
+}
+
+boost::json::value unit::Decoder::json() {
+    return json(0);
+}
+
+boost::json::value unit::Decoder::json(int depth) {
+    if (depth > CODEC_MAX_JSON_DEPTH)
+        throw std::runtime_error("codec: JSON value is nested too deep");
+    uint8_t tag = u8();
+    switch (tag) {
+        case TAG_NULL:
+            return nullptr;
+        case TAG_FALSE:
+            return false;
+        case TAG_TRUE:
+            return true;
+        case TAG_INT64:
+            return static_cast<int64_t>(u64());
+        case TAG_UINT64:
+            return u64();
+        case TAG_DOUBLE:
+            return f64();
+        case TAG_STRING:
+            return boost::json::value(bytes());
+        case TAG_ARRAY: {
+            uint32_t count = u32();
+            boost::json::array array;
+            array.reserve(std::min<std::size_t>(count, this->size - this->position));
+            for (uint32_t i = 0; i < count; ++i)
+                array.push_back(json(depth + 1));
+            return array;
+        }
+        case TAG_OBJECT: {
+            uint32_t count = u32();
+            boost::json::object object;
+            for (uint32_t i = 0; i < count; ++i) {
+                std::string key = bytes();
+                object[key] = json(depth + 1);
+            }
+            return object;
+        }
+        default:
+            throw std::runtime_error("codec: unknown JSON tag " + std::to_string(tag));
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef UVM_CODEC_H
+#define UVM_CODEC_H
+#include "cstdint"
+#include "stdexcept"
+#include "string"
+#include "boost/json.hpp"
+#include "../Hash32.h"
+
+#define CODEC_TX_VERSION 2
+#define CODEC_BLOCK_VERSION 2
+
+// Canonical binary encoding used for hashing, RocksDB values and the mempool journal; JSON is only a view
+// for the HTTP API. Every record starts with its schema version byte, which never collides with '{'
+// of values stored as JSON by older versions.
+//   integers: little-endian, fixed width
+//   doubles:  IEEE-754 bits as u64, -0 is written as 0 and every NaN as the same quiet NaN
+//   strings:  [u32 length][bytes]
+//   hashes:   32 raw bytes
+//   JSON:     [u8 tag][value], object keys sorted, so equal values always have equal encodings
+namespace unit {
+    enum CodecTag : uint8_t {
+        TAG_NULL = 0,
+        TAG_FALSE = 1,
+        TAG_TRUE = 2,
+        TAG_INT64 = 3,
+        TAG_UINT64 = 4,
+        TAG_DOUBLE = 5,
+        TAG_STRING = 6,
+        TAG_ARRAY = 7,   // [u32 count][values]
+        TAG_OBJECT = 8,  // [u32 count][key, value]...
+    };
+
+    // Appends to a caller owned buffer, reserve it with the encoded size to write without reallocations.
+    class Encoder {
+    public:
+        explicit Encoder(std::string *out) : out(out) {}
+
+        void u8(uint8_t value);
+        void u16(uint16_t value);
+        void u32(uint32_t value);
+        void u64(uint64_t value);
+        void f64(double value);
+        void bytes(const std::string &value);
+        void hash(const Hash32 &value);
+        void json(const boost::json::value &value);
+
+        static std::size_t bytes_size(const std::string &value) { return 4 + value.size(); }
+        static std::size_t json_size(const boost::json::value &value);
+
+    private:
+        std::string *out;
+    };
+
+    // Reads what Encoder wrote, throws std::runtime_error on truncated or malformed input.
+    class Decoder {
+    public:
+        Decoder(const char *data, std::size_t size) : data(data), size(size) {}
+        explicit Decoder(const std::string &encoded) : Decoder(encoded.data(), encoded.size()) {}
+
+        uint8_t u8();
+        [[nodiscard]] uint8_t peek() const; // next byte, not consumed
+        uint16_t u16();
+        uint32_t u32();
+        uint64_t u64();
+        double f64();
+        std::string bytes();
+        Decoder frame(std::size_t count); // reads the next count bytes with a decoder of their own, nothing is copied
+        Hash32 hash();
+        boost::json::value json();
+        [[nodiscard]] bool done() const { return position == size; }
+
+    private:
+        const char *data;
+        std::size_t size;
+        std::size_t position = 0;
+
+        const char *take(std::size_t count);
+        boost::json::value json(int depth);
+    };
+
+    // values written before the binary encoding are JSON objects
+    inline bool is_json_encoded(const std::string &value) {
+        return !value.empty() && value[0] == '{';
+    }
+}
+
+#endif //UVM_CODEC_H
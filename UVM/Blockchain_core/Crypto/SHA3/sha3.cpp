@@ -343,4 +343,24 @@ std::string SHA3::operator()(const std::string &text) {
     reset();
     add(text.c_str(), text.size());
     return getHash();
-}
\ No newline at end of file
+}
+
+
+/// write latest hash as m_bits / 8 raw bytes, same byte order as the hex string
+void SHA3::getHash(unsigned char *digest) {
+    // save hash state
+    uint64_t oldHash[StateSize];
+    for (unsigned int i = 0; i < StateSize; i++)
+        oldHash[i] = m_hash[i];
+
+    // process remaining bytes
+    processBuffer();
+
+    unsigned int hashBytes = m_bits / 8;
+    for (unsigned int i = 0; i < hashBytes; i++)
+        digest[i] = (unsigned char) (m_hash[i / 8] >> (8 * (i % 8)));
+
+    // restore state
+    for (unsigned int i = 0; i < StateSize; i++)
+        m_hash[i] = oldHash[i];
+}
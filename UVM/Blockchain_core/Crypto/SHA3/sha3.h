@@ -63,6 +63,9 @@ public:
     /// return latest hash as hex characters
     std::string getHash();
 
+    /// write latest hash as m_bits / 8 raw bytes
+    void getHash(unsigned char *digest);
+
     /// restart
     void reset();
 
@@ -0,0 +1,85 @@
+#include "AddressRegistry.h"
+#include "algorithm"
+#include "mutex"
+#include "stdexcept"
+
+unit::AccountId unit::AddressRegistry::id(const std::string &address) {
+    {
+        std::shared_lock<std::shared_mutex> lock(this->mutex);
+        auto found = this->ids.find(address);
+        if (found != this->ids.end())
+            return found->second;
+    }
+    std::unique_lock<std::shared_mutex> lock(this->mutex);
+    auto [entry, inserted] = this->ids.try_emplace(address, static_cast<AccountId>(this->addresses.size()));
+    if (inserted)
+        this->addresses.push_back(&entry->first);
+    return entry->second;
+}
+
+std::optional<unit::AccountId> unit::AddressRegistry::find(const std::string &address) const {
+    std::shared_lock<std::shared_mutex> lock(this->mutex);
+    auto found = this->ids.find(address);
+    if (found == this->ids.end())
+        return std::nullopt;
+    return found->second;
+}
+
+const std::string &unit::AddressRegistry::address(AccountId id) const {
+    std::shared_lock<std::shared_mutex> lock(this->mutex);
+    if (id >= this->addresses.size() || this->addresses[id] == nullptr)
+        throw std::out_of_range("unknown account id " + std::to_string(id));
+    return *this->addresses[id];
+}
+
+std::size_t unit::AddressRegistry::size() const {
+    std::shared_lock<std::shared_mutex> lock(this->mutex);
+    return this->addresses.size();
+}
+
+unit::AccountId unit::AddressRegistry::persisted() const {
+    std::shared_lock<std::shared_mutex> lock(this->mutex);
+    return this->saved;
+}
+
+void unit::AddressRegistry::mark_persisted(AccountId upto) {
+    std::unique_lock<std::shared_mutex> lock(this->mutex);
+    this->saved = std::max(this->saved, upto);
+}
+
+// ids come back in any order; a gap left by a lost write stays unused
+void unit::AddressRegistry::restore(const std::string &address, AccountId id) {
+    std::unique_lock<std::shared_mutex> lock(this->mutex);
+    auto [entry, inserted] = this->ids.try_emplace(address, id);
+    if (!inserted)
+        return;
+    if (id >= this->addresses.size())
+        this->addresses.resize(id + 1, nullptr);
+    if (this->addresses[id] != nullptr) { // two addresses stored with the same id, the first one keeps it
+        this->ids.erase(entry);
+        return;
+    }
+    this->addresses[id] = &entry->first;
+    this->saved = std::max<AccountId>(this->saved, this->addresses.size());
+}
+
+std::string unit::AddressRegistry::encode_id(AccountId id) {
+    std::string encoded(8, '\0');
+    for (int i = 0; i < 8; ++i)
+        encoded[i] = static_cast<char>(id >> (8 * i));
+    return encoded;
+}
+
+std::optional<unit::AccountId> unit::AddressRegistry::decode_id(const std::string &encoded) {
+    if (encoded.size() != 8)
+        return std::nullopt;
+    AccountId id = 0;
+    for (int i = 0; i < 8; ++i)
+        id |= static_cast<AccountId>(static_cast<unsigned char>(encoded[i])) << (8 * i);
+    return id;
+}
+
+unit::AddressRegistry &unit::AddressRegistry::global() {
+    static AddressRegistry registry;
+    return registry;
+}
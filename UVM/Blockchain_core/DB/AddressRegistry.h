@@ -0,0 +1,46 @@
+#ifndef UVM_ADDRESSREGISTRY_H
+#define UVM_ADDRESSREGISTRY_H
+#include "cstdint"
+#include "deque"
+#include "optional"
+#include "shared_mutex"
+#include "string"
+#include "unordered_map"
+
+namespace unit {
+    typedef uint64_t AccountId;
+
+    // Dense account ids, assigned to an account when a committed block first writes it; reads never assign
+    // one (find), so addresses that are only looked up or submitted cost nothing here. The block executor keys
+    // its per-account state by id; address strings are only kept once here and looked up at the storage and
+    // API boundary. Ids are persisted in the addressIds column family (DB::load_addresses), so an address
+    // keeps its id across restarts.
+    class AddressRegistry {
+    public:
+        // id of address, the next free one when it is seen for the first time
+        AccountId id(const std::string &address);
+        [[nodiscard]] std::optional<AccountId> find(const std::string &address) const;
+        // std::out_of_range for an id that was never assigned
+        [[nodiscard]] const std::string &address(AccountId id) const;
+        [[nodiscard]] std::size_t size() const;
+
+        // ids [persisted(), size()) are not stored yet
+        [[nodiscard]] AccountId persisted() const;
+        void mark_persisted(AccountId upto);
+        // id read back from storage, only before any id is assigned
+        void restore(const std::string &address, AccountId id);
+
+        static std::string encode_id(AccountId id); // u64 little-endian
+        static std::optional<AccountId> decode_id(const std::string &encoded);
+
+        static AddressRegistry &global();
+
+    private:
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, AccountId> ids;
+        std::deque<const std::string *> addresses; // id -> key in ids, nodes of ids never move
+        AccountId saved = 0;
+    };
+}
+
+#endif //UVM_ADDRESSREGISTRY_H
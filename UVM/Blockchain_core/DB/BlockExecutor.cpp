@@ -0,0 +1,355 @@
+#include "BlockExecutor.h"
+#include "DB.h"
+#include "AddressRegistry.h"
+#include "condition_variable"
+#include "mutex"
+#include "optional"
+#include "boost/asio/post.hpp"
+#include "../Wallet/WalletAccount.h"
+#include "../Token/Token.h"
+#include "../Hex.h"
+
+#define ACCOUNT_KEY_ID '\1' // state key of an account with an id: column, tag, u64 id
+#define ACCOUNT_KEY_ADDRESS '\2' // of an account without one: column, tag, address
+
+unit::BlockExecutor::View::View(const StorageReader *storage, const std::unordered_map<std::string, std::string> *committed)
+        : storage(storage), committed(committed) {}
+
+// value is left untouched when the key is not found
+bool unit::BlockExecutor::View::get(int column, const std::string &key, std::string *value) {
+    std::string state_key = BlockExecutor::state_key(column, key);
+    auto own = this->writes.find(state_key);
+    if (own != this->writes.end()) {
+        *value = own->second;
+        return true;
+    }
+    this->reads.push_back(state_key);
+    if (this->committed != nullptr) {
+        auto found = this->committed->find(state_key);
+        if (found != this->committed->end()) {
+            *value = found->second;
+            return true;
+        }
+    }
+    return (*this->storage)(column, key, value);
+}
+
+void unit::BlockExecutor::View::put(int column, const std::string &key, const std::string &value) {
+    this->writes[state_key(column, key)] = value;
+}
+
+unit::BlockExecutor::BlockExecutor(std::size_t threads) : threads(threads == 0 ? 1 : threads), pool(this->threads) {}
+
+unit::BlockExecutor::~BlockExecutor() {
+    this->pool.join();
+}
+
+unit::BlockExecutor::Result unit::BlockExecutor::execute(std::vector<Transaction> &transactions, uint64_t block_index, const StorageReader &storage) {
+    Result result;
+    result.accepted.reserve(transactions.size());
+
+    std::vector<Speculation> speculations;
+    bool speculative = this->threads > 1 && transactions.size() >= EXECUTOR_MIN_PARALLEL_TXS;
+    if (speculative) {
+        speculations.reserve(transactions.size());
+        for (std::size_t i = 0; i < transactions.size(); ++i)
+            speculations.push_back(Speculation{View(&storage, nullptr), APPLIED, false});
+        speculate(transactions, block_index, speculations);
+    }
+
+    // validation in block order: a speculative run is kept only if nothing it read was written before it
+    for (std::size_t i = 0; i < transactions.size(); ++i) {
+        View *view = nullptr;
+        std::optional<View> again;
+        Outcome outcome;
+        bool valid = speculative && !speculations[i].failed;
+        if (valid) {
+            for (const std::string &key : speculations[i].view.reads) {
+                if (result.writes.find(key) != result.writes.end()) {
+                    valid = false;
+                    break;
+                }
+            }
+        }
+
+        if (valid) {
+            view = &speculations[i].view;
+            outcome = speculations[i].outcome;
+        } else {
+            again.emplace(&storage, &result.writes);
+            view = &again.value();
+            outcome = apply(transactions[i], block_index, *view);
+            if (speculative)
+                result.reexecuted++;
+        }
+
+        if (outcome == INVALID) {
+            result.invalid = true;
+            return result;
+        }
+        if (outcome == APPLIED) // a rejected transaction leaves no trace in the state
+            for (auto &[key, value] : view->writes)
+                result.writes[key] = std::move(value);
+        result.accepted.push_back(outcome == APPLIED);
+    }
+    return result;
+}
+
+void unit::BlockExecutor::speculate(std::vector<Transaction> &transactions, uint64_t block_index, std::vector<Speculation> &speculations) {
+    std::atomic<std::size_t> next{0};
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::size_t workers = std::min(this->threads, transactions.size());
+    std::size_t running = workers + 1; // calling thread takes transactions as well
+
+    auto work = [&] {
+        for (std::size_t i = next.fetch_add(1); i < transactions.size(); i = next.fetch_add(1)) {
+            try {
+                speculations[i].outcome = apply(transactions[i], block_index, speculations[i].view);
+            } catch (std::exception &e) {
+                speculations[i].failed = true; // possibly caused by a stale read, decided again in order
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--running == 0)
+            finished.notify_one();
+    };
+
+    for (std::size_t i = 0; i < workers; ++i)
+        boost::asio::post(this->pool, work);
+    work();
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&] { return running == 0; });
+}
+
+unit::BlockExecutor::Outcome unit::BlockExecutor::apply(Transaction &transaction, uint64_t block_index, View &state) {
+    transaction.setBlockId(block_index);
+    std::string recipient;
+
+    // a transaction out of its sender's sequence has no effect at all
+    if (block_index != 1) {
+        std::string sender;
+        if (!state.get(CF_ACCOUNTS, transaction.from, &sender) || account_nonce(boost::json::parse(sender).as_object()) != transaction.nonce)
+            return REJECTED;
+    }
+
+    if (transaction.type != CREATE_TOKEN) {
+        if (!state.get(CF_ACCOUNTS, transaction.to, &recipient)) { // looking for account and it's balance
+            WalletAccount walletAccount = WalletAccount(transaction.to, 0, {});
+            recipient = walletAccount.to_json_string();
+            state.put(CF_ACCOUNTS, transaction.to, recipient);
+        }
+    }
+
+    if (transaction.type == UNIT_TRANSFER)
+        goto unit_transfer;
+    else if (transaction.type == CREATE_TOKEN)
+        goto create_token;
+    else if (transaction.type == TOKEN_TRANSFER)
+        goto transfer_tokens;
+    else
+        return INVALID;
+
+
+    unit_transfer: {
+    boost::json::object recipient_json = boost::json::parse(recipient).as_object();
+    state.get(CF_ACCOUNTS, transaction.from, &recipient); // looking for account and it's balance
+
+    if(block_index == 1) {
+        recipient_json["amount"] = boost::json::value_to<double>(recipient_json["amount"]) + transaction.amount;
+        recipient_json["inputs"].as_array().emplace_back(transaction.hash.to_hex());
+        state.put(CF_ACCOUNTS, transaction.to, serialize(recipient_json));
+        goto push_tx;
+    }
+
+    boost::json::object sender_json = boost::json::parse(recipient).as_object();
+    if(!sender_json.contains("amount") || (boost::json::value_to<double>(sender_json["amount"]) < transaction.amount + fee_in_units(transaction)))
+        return REJECTED;
+
+    if (transaction.from == transaction.to) { // one account, only the fee leaves it
+        sender_json["amount"] = boost::json::value_to<double>(sender_json["amount"]) - fee_in_units(transaction);
+        sender_json["inputs"].as_array().emplace_back(transaction.hash.to_hex());
+        sender_json["outputs"].as_array().emplace_back(transaction.hash.to_hex());
+        sender_json["nonce"] = transaction.nonce + 1;
+        state.put(CF_ACCOUNTS, transaction.from, serialize(sender_json));
+        goto push_tx;
+    }
+
+    sender_json["amount"] = boost::json::value_to<double>(sender_json["amount"]) - transaction.amount - fee_in_units(transaction); // for genesis comment this
+    recipient_json["amount"] = boost::json::value_to<double>(recipient_json["amount"]) + transaction.amount;
+    recipient_json["inputs"].as_array().emplace_back(transaction.hash.to_hex());
+    sender_json["outputs"].as_array().emplace_back(transaction.hash.to_hex());
+    sender_json["nonce"] = transaction.nonce + 1;
+
+    state.put(CF_ACCOUNTS, transaction.from, serialize(sender_json)); // for genesis comment this
+    state.put(CF_ACCOUNTS, transaction.to, serialize(recipient_json));
+    goto push_tx;
+};
+
+    create_token: {
+    if (!transaction.payload.has(unit::TxPayload::BYTECODE))
+        return REJECTED;
+
+    std::string hex = transaction.payload.bytecode();
+    std::string token_name;
+    double supply;
+    try {
+        boost::json::object bytecode_parsed = boost::json::parse(hex_to_ascii(hex)).as_object();
+        token_name = boost::json::value_to<std::string>(bytecode_parsed.at("name"));
+        supply = boost::json::value_to<double>(bytecode_parsed.at("supply"));
+    } catch (std::exception &e) {
+        return REJECTED;
+    }
+
+    std::string token;
+    state.get(CF_TOKENS, token_name, &token); // looking for token, under the key it is written with
+    if(!token.empty())
+        return REJECTED;
+
+    // the creator must pay the fee before the name is taken
+    if (!state.get(CF_ACCOUNTS, transaction.from, &recipient)) // looking for account and it's balance
+        return REJECTED;
+    boost::json::object creator = boost::json::parse(recipient).as_object();
+    if (!creator.contains("amount") || boost::json::value_to<double>(creator["amount"]) < fee_in_units(transaction))
+        return REJECTED;
+
+    Token token_created = Token(token_name, transaction.payload.bytecode(), transaction.from, supply);
+    state.put(CF_TOKENS, token_created.name, token_created.to_json_string());
+    transaction.setTo(token_created.token_hash);
+
+    creator["amount"] = boost::json::value_to<double>(creator["amount"]) - fee_in_units(transaction);
+    boost::json::object prepared_token_json;
+
+    prepared_token_json.emplace(token_created.name, token_created.supply);
+    creator["tokens_balance"].as_array().emplace_back(prepared_token_json);
+
+    creator["outputs"].as_array().emplace_back(transaction.hash.to_hex());
+    creator["nonce"] = transaction.nonce + 1;
+    state.put(CF_ACCOUNTS, transaction.from, serialize(creator));
+    goto push_tx;
+};
+
+    transfer_tokens: {
+    const std::string &token_name = transaction.payload.name();
+    if (!transaction.payload.token_amount().has_value())
+        return REJECTED;
+    double token_amount = transaction.payload.token_amount().value();
+    std::string token;
+
+    state.get(CF_TOKENS, token_name, &token); // looking for token
+    if(token.empty())
+        return REJECTED;
+
+    if (transaction.from == transaction.to) { // one account, the tokens stay and only the fee is paid
+        boost::json::object account_json = boost::json::parse(recipient).as_object();
+        if (!account_json.contains("amount") || boost::json::value_to<double>(account_json["amount"]) < fee_in_units(transaction))
+            return REJECTED;
+        bool enough_tokens = false;
+        for (const boost::json::value &balance : account_json.at("tokens_balance").as_array())
+            if (balance.as_object().contains(token_name) && boost::json::value_to<double>(balance.at(token_name)) >= token_amount)
+                enough_tokens = true;
+        if (!enough_tokens)
+            return REJECTED;
+        account_json["amount"] = boost::json::value_to<double>(account_json["amount"]) - fee_in_units(transaction);
+        account_json["inputs"].as_array().emplace_back(transaction.hash.to_hex());
+        account_json["outputs"].as_array().emplace_back(transaction.hash.to_hex());
+        account_json["nonce"] = transaction.nonce + 1;
+        state.put(CF_ACCOUNTS, transaction.from, serialize(account_json));
+        goto push_tx;
+    }
+
+    boost::json::object recipient_json = boost::json::parse(recipient).as_object();
+
+    bool balance_in_token = false;
+    for(boost::json::array::iterator it = recipient_json.at("tokens_balance").as_array().begin(); it != recipient_json.at("tokens_balance").as_array().end(); ++it){
+        if(it->as_object().contains(token_name)) {
+            it->as_object()[token_name] = boost::json::value_to<double>(it->at(token_name)) + token_amount;
+            balance_in_token = true;
+        }
+    }
+
+    if (!balance_in_token) {
+        boost::json::object prepared_token_json;
+        prepared_token_json.emplace(token_name, token_amount);
+        recipient_json["tokens_balance"].as_array().emplace_back(prepared_token_json);
+    }
+
+    std::string sender;
+    state.get(CF_ACCOUNTS, transaction.from, &sender); // looking for token
+
+    if (sender.empty())
+        return REJECTED;
+
+    boost::json::object sender_json = boost::json::parse(sender).as_object();
+    if (boost::json::value_to<double>(sender_json["amount"]) < fee_in_units(transaction))
+        return REJECTED;
+    sender_json["amount"] = boost::json::value_to<double>(sender_json["amount"]) - fee_in_units(transaction);
+    balance_in_token = false;
+    for(boost::json::array::iterator it = sender_json.at("tokens_balance").as_array().begin(); it != sender_json.at("tokens_balance").as_array().end(); ++it){
+        if(it->as_object().contains(token_name)) {
+            if (boost::json::value_to<double>(it->at(token_name)) < token_amount)
+                return REJECTED;
+            it->as_object()[token_name] = boost::json::value_to<double>(it->at(token_name)) - token_amount;
+            balance_in_token = true;
+        }
+    }
+
+    if (!balance_in_token)
+        return REJECTED;
+
+    recipient_json["inputs"].as_array().emplace_back(transaction.hash.to_hex());
+    sender_json["outputs"].as_array().emplace_back(transaction.hash.to_hex());
+    sender_json["nonce"] = transaction.nonce + 1;
+    state.put(CF_ACCOUNTS, transaction.to, serialize(recipient_json));
+    state.put(CF_ACCOUNTS, transaction.from, serialize(sender_json));
+
+    goto push_tx;
+};
+
+    push_tx:{
+    state.put(CF_TX, std::string(transaction.hash.view()), transaction.encode()); // raw 32 byte key
+};
+
+    return APPLIED;
+}
+
+double unit::BlockExecutor::fee_in_units(const Transaction &transaction) {
+    return transaction.fee / SUBUNITS_PER_UNIT;
+}
+
+uint64_t unit::BlockExecutor::account_nonce(const boost::json::object &account) {
+    if (!account.contains("nonce"))
+        return 0; // accounts created before nonces
+    return boost::json::value_to<uint64_t>(account.at("nonce"));
+}
+
+// Accounts are keyed by their id: 10 bytes fit in the string itself, no allocation per read or write. Only a
+// committed block assigns ids (to the accounts it writes), so an address without one is keyed by itself.
+std::string unit::BlockExecutor::state_key(int column, const std::string &key) {
+    std::string state_key;
+    state_key.push_back(static_cast<char>(column));
+    if (column == CF_ACCOUNTS) {
+        std::optional<AccountId> id = AddressRegistry::global().find(key);
+        if (id.has_value()) {
+            state_key.push_back(ACCOUNT_KEY_ID);
+            state_key.append(AddressRegistry::encode_id(id.value()));
+            return state_key;
+        }
+        state_key.push_back(ACCOUNT_KEY_ADDRESS);
+    }
+    state_key.reserve(state_key.size() + key.size());
+    state_key.append(key);
+    return state_key;
+}
+
+int unit::BlockExecutor::state_column(const std::string &state_key) {
+    return static_cast<int>(state_key.front());
+}
+
+std::string unit::BlockExecutor::state_user_key(const std::string &state_key) {
+    if (state_column(state_key) != CF_ACCOUNTS)
+        return state_key.substr(1);
+    if (state_key[1] == ACCOUNT_KEY_ID)
+        return AddressRegistry::global().address(AddressRegistry::decode_id(state_key.substr(2)).value());
+    return state_key.substr(2);
+}
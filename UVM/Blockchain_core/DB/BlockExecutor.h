@@ -0,0 +1,89 @@
+#ifndef UVM_BLOCKEXECUTOR_H
+#define UVM_BLOCKEXECUTOR_H
+#include "atomic"
+#include "functional"
+#include "string"
+#include "unordered_map"
+#include "vector"
+#include "boost/asio/thread_pool.hpp"
+#include "../Transaction.h"
+
+#define EXECUTOR_MIN_PARALLEL_TXS 8 // smaller blocks are applied sequentially, speculation doesn't pay off
+
+// column families touched by transactions, same order as in DB::columnFamilies
+#define CF_TOKENS 1
+#define CF_TX 2
+#define CF_ACCOUNTS 4
+
+namespace unit {
+    // Reads the state before the block: (column family, key) -> value, false when the key is not found.
+    // Must be safe to call from several threads at once.
+    typedef std::function<bool(int, const std::string &, std::string *)> StorageReader;
+
+    // Applies block transactions optimistically in parallel.
+    // Every transaction is first executed speculatively on a worker against the state before the block,
+    // recording the keys it read and buffering what it wrote. Then transactions are validated in block order:
+    // if nothing a transaction read was written by an earlier transaction of the block its buffered writes are
+    // taken as they are, otherwise it is executed again on top of the earlier writes. The result is exactly
+    // the one of applying transactions one after another.
+    class BlockExecutor {
+    public:
+        enum Outcome {
+            APPLIED = 0,
+            REJECTED = 1,   // transaction is dropped from the block, whatever it wrote before is discarded
+            INVALID = 2,    // unknown transaction type, the block is not applied
+        };
+
+        struct Result {
+            std::vector<bool> accepted;
+            std::unordered_map<std::string, std::string> writes; // state key -> value after the block
+            std::size_t reexecuted = 0;
+            bool invalid = false;
+        };
+
+        // Transaction reads and writes go through a view so the same code runs speculatively and in order
+        class View {
+        public:
+            View(const StorageReader *storage, const std::unordered_map<std::string, std::string> *committed);
+
+            bool get(int column, const std::string &key, std::string *value);
+            void put(int column, const std::string &key, const std::string &value);
+
+        private:
+            friend class BlockExecutor;
+            const StorageReader *storage;
+            const std::unordered_map<std::string, std::string> *committed; // writes of earlier transactions
+            std::vector<std::string> reads; // state keys read from outside of this transaction
+            std::unordered_map<std::string, std::string> writes;
+        };
+
+        explicit BlockExecutor(std::size_t threads);
+        virtual ~BlockExecutor();
+
+        // Transactions are updated in place (block id, created token address).
+        Result execute(std::vector<Transaction> &transactions, uint64_t block_index, const StorageReader &storage);
+
+        static Outcome apply(Transaction &transaction, uint64_t block_index, View &state);
+        static std::string state_key(int column, const std::string &key);
+        static int state_column(const std::string &state_key);
+        static std::string state_user_key(const std::string &state_key);
+
+    private:
+        struct Speculation {
+            View view;
+            Outcome outcome;
+            bool failed;
+        };
+
+        const std::size_t threads;
+        boost::asio::thread_pool pool;
+
+        // fees are burned: charged from sender's unit balance and credited to nobody
+        static double fee_in_units(const Transaction &transaction);
+        static uint64_t account_nonce(const boost::json::object &account);
+        void speculate(std::vector<Transaction> &transactions, uint64_t block_index, std::vector<Speculation> &speculations);
+    };
+}
+
+
+#endif //UVM_BLOCKEXECUTOR_H
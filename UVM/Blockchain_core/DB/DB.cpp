@@ -3,6 +3,7 @@
 //
 
 #include "DB.h"
+#include "../../ENV/env.h"
 #include "boost/json/src.hpp"
 #include "boost/json/array.hpp"
 #include "boost/json/object.hpp"
@@ -42,10 +43,45 @@ std::vector<rocksdb::ColumnFamilyDescriptor> unit::DB::get_column_families() {
                                                                          rocksdb::ColumnFamilyDescriptor("tx", rocksdb::ColumnFamilyOptions()),
                                                                          rocksdb::ColumnFamilyDescriptor("height", rocksdb::ColumnFamilyOptions()),
                                                                          rocksdb::ColumnFamilyDescriptor("accountBalance", rocksdb::ColumnFamilyOptions()),
-                                                                         rocksdb::ColumnFamilyDescriptor(ROCKSDB_NAMESPACE::kDefaultColumnFamilyName, rocksdb::ColumnFamilyOptions())};
+                                                                         rocksdb::ColumnFamilyDescriptor(ROCKSDB_NAMESPACE::kDefaultColumnFamilyName, rocksdb::ColumnFamilyOptions()),
+                                                                         rocksdb::ColumnFamilyDescriptor("txBlock", rocksdb::ColumnFamilyOptions()),
+                                                                         rocksdb::ColumnFamilyDescriptor("addressIds", rocksdb::ColumnFamilyOptions())};
     return *&columnFamilies;
 }
 
+bool unit::DB::create_missing_column_families() {
+    rocksdb::DB *db = nullptr;
+    std::vector<rocksdb::ColumnFamilyHandle*> handles;
+    rocksdb::Status status = rocksdb::DB::Open(unit::DB::get_db_options(), kkDBPath, unit::DB::get_column_families(), &handles, &db);
+    if (!status.ok()) {
+        std::cout << "Error: " << status.ToString() << std::endl;
+        return false;
+    }
+    close_db(db, &handles);
+    return true;
+}
+
+bool unit::DB::load_addresses() {
+    rocksdb::DB *db = nullptr;
+    std::vector<rocksdb::ColumnFamilyHandle*> handles;
+    rocksdb::Status status = rocksdb::DB::OpenForReadOnly(unit::DB::get_db_options(), kkDBPath, unit::DB::get_column_families(), &handles, &db);
+    if (!status.ok()) {
+        std::cout << "Error: " << status.ToString() << std::endl;
+        return false;
+    }
+    unit::AddressRegistry &registry = unit::AddressRegistry::global();
+    rocksdb::Iterator *iterator = db->NewIterator(rocksdb::ReadOptions(), handles[CF_ADDRESS_IDS]);
+    for (iterator->SeekToFirst(); iterator->Valid(); iterator->Next()) {
+        std::optional<unit::AccountId> id = unit::AddressRegistry::decode_id(iterator->value().ToString());
+        if (id.has_value())
+            registry.restore(iterator->key().ToString(), id.value());
+    }
+    delete iterator;
+    close_db(db, &handles);
+    std::cout << "Address registry: restored " << registry.size() << " account ids" << std::endl;
+    return true;
+}
+
 std::optional<std::string> unit::DB::get_block_height() {
     rocksdb::DB *db;
     std::vector<rocksdb::ColumnFamilyHandle*> handles;
@@ -62,7 +98,7 @@ std::optional<std::string> unit::DB::get_block_height() {
     close_db(db, &handles);
     if (height.empty())
         return std::nullopt;
-    return height;
+    return block_to_json(height);
 }
 
 std::optional<std::string> unit::DB::get_balance(std::string &address) {
@@ -92,6 +128,34 @@ std::optional<std::string> unit::DB::get_balance(std::string &address) {
     return balance;
 }
 
+std::optional<std::vector<std::optional<std::string>>> unit::DB::get_balances(const std::vector<std::string> &addresses) {
+    rocksdb::DB *db = nullptr;
+    std::vector<rocksdb::ColumnFamilyHandle*> handles;
+    rocksdb::Status status = rocksdb::DB::OpenForReadOnly(unit::DB::get_db_options(), kkDBPath, unit::DB::get_column_families(), &handles, &db);
+    if (!status.ok()) {
+        std::cout << "Error: " << status.ToString() << std::endl;
+        return std::nullopt;
+    }
+    std::vector<rocksdb::Slice> keys(addresses.begin(), addresses.end());
+    std::vector<rocksdb::PinnableSlice> values(addresses.size());
+    std::vector<rocksdb::Status> statuses(addresses.size());
+    db->MultiGet(rocksdb::ReadOptions(), handles[4], keys.size(), keys.data(), values.data(), statuses.data());
+
+    std::optional<std::vector<std::optional<std::string>>> balances = std::vector<std::optional<std::string>>(addresses.size());
+    for (std::size_t i = 0; i < addresses.size(); ++i) {
+        if (statuses[i].ok()) {
+            (*balances)[i] = values[i].ToString();
+        } else if (!statuses[i].IsNotFound()) {
+            std::cout << "Error: " << statuses[i].ToString() << std::endl;
+            balances = std::nullopt;
+            break;
+        }
+    }
+    values.clear(); // pinned values must be released before the database is closed
+    close_db(db, &handles);
+    return balances;
+}
+
 bool unit::DB::push_transactions(Block *block) {
     rocksdb::Options options;
     rocksdb::DBOptions dbOptions;
@@ -102,190 +166,70 @@ bool unit::DB::push_transactions(Block *block) {
     rocksdb::WriteOptions write_options;
     rocksdb::ReadOptions read_options;
     rocksdb::OptimisticTransactionOptions txn_options;
-    std::string value;
     txn_options.set_snapshot = true;
     rocksdb::Transaction* txn = txn_db->BeginTransaction(write_options, txn_options);
+    read_options.snapshot = txn->GetSnapshot();
 
-    for (Transaction &transaction : block->transactions) {
-        transaction.setBlockId(block->getIndex());
-        const rocksdb::Snapshot* snapshot = txn->GetSnapshot();
-        read_options.snapshot = snapshot;
-        std::string recipient;
-
-        if (transaction.type != CREATE_TOKEN) {
-            s = txn->Get(read_options, handles[4], rocksdb::Slice(transaction.to),&recipient); // looking for account and it's balance
-            if (s.IsNotFound()) {
-                WalletAccount walletAccount = WalletAccount(transaction.to, 0, {});
-                recipient = walletAccount.to_json_string();
-                s = txn->PutUntracked(handles[4], rocksdb::Slice(transaction.to), rocksdb::Slice(recipient));
-            }
-        }
-
-        if (transaction.type == UNIT_TRANSFER)
-            goto unit_transfer;
-        else if (transaction.type == CREATE_TOKEN)
-            goto create_token;
-        else if (transaction.type == TOKEN_TRANSFER)
-            goto transfer_tokens;
-        else
+    // transactions only read the state as it was before the block, the executor keeps track of the block's own writes
+    rocksdb::DB *base_db = txn_db->GetBaseDB();
+    unit::StorageReader storage = [&](int column, const std::string &key, std::string *value) {
+        std::string found;
+        if (!base_db->Get(read_options, handles[column], rocksdb::Slice(key), &found).ok())
             return false;
-
-
-        unit_transfer: {
-        boost::json::object recipient_json = boost::json::parse(recipient).as_object();
-        s = txn->Get(rocksdb::ReadOptions(), handles[4], rocksdb::Slice(transaction.from), &recipient); // looking for account and it's balance
-
-        if(block->index == 1) {
-            recipient_json["amount"] = boost::json::value_to<double>(recipient_json["amount"]) + transaction.amount;
-            recipient_json["inputs"].as_array().emplace_back(transaction.hash);
-            s = txn->PutUntracked(handles[4], rocksdb::Slice(transaction.to), rocksdb::Slice(serialize(recipient_json)));
-            goto push_tx;
-        }
-
-        boost::json::object sender_json = boost::json::parse(recipient).as_object();
-        if(!sender_json.contains("amount") || (boost::json::value_to<double>(sender_json["amount"]) < transaction.amount)) {
-            block->transactions.erase(
-                    std::remove(block->transactions.begin(), block->transactions.end(), transaction),
-                    block->transactions.end());
-            goto leave;
-        }
-
-        sender_json["amount"] = boost::json::value_to<double>(sender_json["amount"]) - transaction.amount; // for genesis comment this
-        recipient_json["amount"] = boost::json::value_to<double>(recipient_json["amount"]) + transaction.amount;
-        recipient_json["inputs"].as_array().emplace_back(transaction.hash);
-        sender_json["outputs"].as_array().emplace_back(transaction.hash);
-
-        s = txn->PutUntracked(handles[4], rocksdb::Slice(transaction.from), rocksdb::Slice(serialize(sender_json))); // for genesis comment this
-        s = txn->PutUntracked(handles[4], rocksdb::Slice(transaction.to), rocksdb::Slice(serialize(recipient_json)));
-        goto push_tx;
+        *value = std::move(found);
+        return true;
     };
 
-        create_token: {
-        boost::json::object transaction_parser = boost::json::parse(transaction.to_json_string_test()).as_object();
-        if (!transaction_parser["extradata"].as_object().contains("bytecode")) {
-            block->transactions.erase(
-                    std::remove(block->transactions.begin(), block->transactions.end(), transaction),
-                    block->transactions.end());
-            goto leave;
-        }
-
-        std::string hex = boost::json::value_to<std::string>(transaction_parser["extradata"].at("bytecode"));
-        boost::json::object bytecode_parsed;
-        try {
-            bytecode_parsed = boost::json::parse(hex_to_ascii(hex)).as_object();
-        } catch (std::exception &e) {
-            block->transactions.erase(
-                    std::remove(block->transactions.begin(), block->transactions.end(), transaction),
-                    block->transactions.end());
-            goto leave;
-        }
-
-        std::string token;
-        s = txn->Get(rocksdb::ReadOptions(), handles[1], rocksdb::Slice(serialize(bytecode_parsed["name"])), &token); // looking for token
-        if(!token.empty()) {
-            block->transactions.erase(
-                    std::remove(block->transactions.begin(), block->transactions.end(), transaction),
-                    block->transactions.end());
-            goto leave;
-        }
-
-        Token token_created = Token(boost::json::value_to<std::string>(bytecode_parsed["name"]), boost::json::value_to<std::string>(transaction.extra.at("bytecode")), transaction.from, boost::json::value_to<double>(bytecode_parsed["supply"]));
-        s = txn->PutUntracked(handles[1], rocksdb::Slice(token_created.name), rocksdb::Slice(token_created.to_json_string()));
-        transaction.setTo(token_created.token_hash);
-
-        s = txn->Get(rocksdb::ReadOptions(), handles[4], rocksdb::Slice(transaction.from), &recipient); // looking for account and it's balance
-
-        boost::json::object creator = boost::json::parse(recipient).as_object();
-        boost::json::object prepared_token_json;
-
-        prepared_token_json.emplace(token_created.name, token_created.supply);
-        creator["tokens_balance"].as_array().emplace_back(prepared_token_json);
-
-        creator["outputs"].as_array().emplace_back(transaction.hash);
-        s = txn->PutUntracked(handles[4], rocksdb::Slice(transaction.from), rocksdb::Slice(serialize(creator)));
-        goto push_tx;
-    };
-
-        transfer_tokens: {
-        std::string token;
+    unit::BlockExecutor::Result result;
+    try {
+        result = executor().execute(block->transactions, block->getIndex(), storage);
+    } catch (std::exception &e) {
+        for (auto &handle : handles)
+            txn_db->DestroyColumnFamilyHandle(handle);
+        delete txn;
+        delete txn_db;
+        throw;
+    }
 
-        s = txn->Get(rocksdb::ReadOptions(), handles[1], rocksdb::Slice(boost::json::value_to<std::string>(transaction.extra.at("name"))), &token); // looking for token
-        if(token.empty()) {
-            block->transactions.erase(
-                    std::remove(block->transactions.begin(), block->transactions.end(), transaction),
-                    block->transactions.end());
-            goto leave;
+    unit::AccountId addresses_assigned = 0;
+    if (!result.invalid) {
+        unit::AddressRegistry &registry = unit::AddressRegistry::global();
+        for (const auto &[state_key, value] : result.writes) {
+            int column = unit::BlockExecutor::state_column(state_key);
+            std::string key = unit::BlockExecutor::state_user_key(state_key);
+            if (column == CF_ACCOUNTS)
+                registry.id(key); // an account gets its id with the block that writes it first
+            s = txn->PutUntracked(handles[column], rocksdb::Slice(key), rocksdb::Slice(value));
         }
 
-        boost::json::object recipient_json = boost::json::parse(recipient).as_object();
+        // ids assigned by this block, and by earlier ones whose commit failed
+        addresses_assigned = registry.size();
+        for (unit::AccountId id = registry.persisted(); id < addresses_assigned; ++id)
+            s = txn->PutUntracked(handles[CF_ADDRESS_IDS], rocksdb::Slice(registry.address(id)), rocksdb::Slice(unit::AddressRegistry::encode_id(id)));
 
-        bool balance_in_token = false;
-        for(boost::json::array::iterator it = recipient_json.at("tokens_balance").as_array().begin(); it != recipient_json.at("tokens_balance").as_array().end(); ++it){
-            if(it->as_object().contains(transaction.extra.at("name").as_string())) {
-                it->as_object()[transaction.extra.at("name").as_string()] = boost::json::value_to<double>(it->at(transaction.extra.at("name").as_string())) + std::stod(boost::json::value_to<std::string>(transaction.extra.as_object()["value"]));
-                balance_in_token = true;
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < block->transactions.size(); ++i) {
+            if (!result.accepted[i]) {
+                std::cout << "block #" << block->getIndex() << ": transaction " << block->transactions[i].hash << " rejected on execution" << std::endl;
+                continue;
             }
+            if (kept != i)
+                block->transactions[kept] = std::move(block->transactions[i]);
+            kept++;
         }
+        block->transactions.erase(block->transactions.begin() + static_cast<long>(kept), block->transactions.end());
+        if (result.reexecuted > 0)
+            std::cout << "block #" << block->getIndex() << ": " << result.reexecuted << " of " << result.accepted.size() << " transactions re-executed after conflicts" << std::endl;
 
-        if (!balance_in_token) {
-            boost::json::object prepared_token_json;
-            prepared_token_json.emplace(transaction.extra.at("name").as_string(),  std::stod(boost::json::value_to<std::string>(transaction.extra.as_object()["value"])));
-            recipient_json["tokens_balance"].as_array().emplace_back(prepared_token_json);
-        }
-
-        std::string sender;
-        s = txn->Get(rocksdb::ReadOptions(), handles[4], rocksdb::Slice(transaction.from), &sender); // looking for token
-
-        if (sender.empty()) {
-            block->transactions.erase(
-                    std::remove(block->transactions.begin(), block->transactions.end(), transaction),
-                    block->transactions.end());
-            goto leave;
-        }
-
-        boost::json::object sender_json = boost::json::parse(sender).as_object();
-        balance_in_token = false;
-        for(boost::json::array::iterator it = sender_json.at("tokens_balance").as_array().begin(); it != sender_json.at("tokens_balance").as_array().end(); ++it){
-            if(it->as_object().contains(transaction.extra.at("name").as_string())) {
-                if (boost::json::value_to<double>(it->at(transaction.extra.at("name").as_string())) <  std::stod(boost::json::value_to<std::string>(transaction.extra.as_object()["value"]))) {
-                    block->transactions.erase(
-                            std::remove(block->transactions.begin(), block->transactions.end(), transaction),
-                            block->transactions.end());
-                    goto leave;
-                }
-                it->as_object()[transaction.extra.at("name").as_string()] = boost::json::value_to<double>(it->at(transaction.extra.at("name").as_string())) - std::stod(boost::json::value_to<std::string>(transaction.extra.as_object()["value"]));
-                balance_in_token = true;
-            }
-        }
-
-        if (!balance_in_token) {
-            block->transactions.erase(
-                    std::remove(block->transactions.begin(), block->transactions.end(), transaction),
-                    block->transactions.end());
-            goto leave;
-        }
-
-        recipient_json["inputs"].as_array().emplace_back(transaction.hash);
-        sender_json["outputs"].as_array().emplace_back(transaction.hash);
-        s = txn->PutUntracked(handles[4], rocksdb::Slice(transaction.to), rocksdb::Slice(serialize(recipient_json)));
-        s = txn->PutUntracked(handles[4], rocksdb::Slice(transaction.from), rocksdb::Slice(serialize(sender_json)));
-
-        goto push_tx;
-    };
-
-        push_tx:{
-        s = txn->PutUntracked(handles[2], rocksdb::Slice(transaction.hash), rocksdb::Slice(transaction.to_json_string_test()));
-    };
-
-        leave:{ snapshot = nullptr; };
+        s = txn->Commit();
     }
 
-    s = txn->Commit();
-
     await: {
     if (s.IsBusy())
         goto await;
 };
+    if (!result.invalid && s.ok())
+        unit::AddressRegistry::global().mark_persisted(addresses_assigned);
 
     for (auto &handle : handles)
         txn_db->DestroyColumnFamilyHandle(handle);
@@ -293,7 +237,12 @@ bool unit::DB::push_transactions(Block *block) {
     delete txn;
     delete txn_db;
 
-    return true;
+    return !result.invalid && s.ok();
+}
+
+unit::BlockExecutor &unit::DB::executor() {
+    static unit::BlockExecutor block_executor(unit::env_u64("UNIT_EXECUTOR_THREADS", cpuss));
+    return block_executor;
 }
 
 std::optional<std::string> unit::DB::get_token(std::string &token_address) {
@@ -310,7 +259,7 @@ std::optional<std::string> unit::DB::get_token(std::string &token_address) {
     return token;
 }
 
-bool unit::DB::push_block(Block block) {
+bool unit::DB::push_block(Block &block) {
     await_when_db_is_not_busy:{};
     rocksdb::Options options;
     rocksdb::DBOptions dbOptions;
@@ -338,20 +287,27 @@ bool unit::DB::push_block(Block block) {
 
     genesis: {
     block.setIndex(1);
-    block.setPrevHash("genesis");
+    block.setPrevHash(unit::Hash32());
     goto push_values;
 };
 
     common: {
-    boost::json::value parsed_current = boost::json::parse(height);
-    block.setPrevHash(boost::json::value_to<std::string>(parsed_current.at("hash")));
+    if (unit::is_json_encoded(height)) {
+        boost::json::value parsed_current = boost::json::parse(height);
+        block.setPrevHash(unit::Hash32::from_hex(boost::json::value_to<std::string>(parsed_current.at("hash"))).value_or(unit::Hash32()));
+    } else {
+        block.setPrevHash(Block::decode(height).hash);
+    }
     goto push_values;
 };
 
     push_values: {
     std::cout << "block #" << block.getIndex() << ": " << block.to_json_with_tx_hash_only() << std::endl;
-    s = txn->PutUntracked(handles[0], rocksdb::Slice(block.hash), rocksdb::Slice(block.to_json_with_tx_hash_only()));
-    s = txn->PutUntracked(handles[3], rocksdb::Slice("current"), rocksdb::Slice(block.to_json_with_tx_hash_only()));
+    std::string encoded_block = block.encode();
+    s = txn->PutUntracked(handles[0], hash_key(block.hash), rocksdb::Slice(encoded_block));
+    s = txn->PutUntracked(handles[3], rocksdb::Slice("current"), rocksdb::Slice(encoded_block));
+    for (const Transaction &transaction : block.transactions)
+        s = txn->PutUntracked(handles[CF_TX_BLOCK], hash_key(transaction.hash), hash_key(block.hash));
 };
 
     s = txn->Commit();
@@ -371,19 +327,60 @@ bool unit::DB::push_block(Block block) {
 }
 
 
-std::optional<std::string> unit::DB::find_transaction(std::string tx_hash) {
+std::optional<std::string> unit::DB::find_transaction(const unit::Hash32 &tx_hash) {
     rocksdb::DB *db;
     std::vector<rocksdb::ColumnFamilyHandle*> handles;
     rocksdb::Status status = rocksdb::DB::OpenForReadOnly(unit::DB::get_db_options(), kkDBPath, unit::DB::get_column_families(), &handles, &db);
 
     std::string tx;
-    status = db->Get(rocksdb::ReadOptions(), handles[2], rocksdb::Slice(std::move(tx_hash)), &tx);
+    status = get_by_hash(db, handles[2], tx_hash, &tx);
 
     unit::DB::close_db(db, &handles);
     if(tx.empty())
         return std::nullopt;
 
-    return tx;
+    return transaction_to_json(tx);
+}
+
+std::optional<std::string> unit::DB::find_transaction_block(const unit::Hash32 &tx_hash) {
+    rocksdb::DB *db = nullptr;
+    std::vector<rocksdb::ColumnFamilyHandle*> handles;
+    rocksdb::Status status = rocksdb::DB::OpenForReadOnly(unit::DB::get_db_options(), kkDBPath, unit::DB::get_column_families(), &handles, &db);
+    if(db == nullptr) {
+        close_db(db, &handles);
+        return std::nullopt;
+    }
+
+    std::string block_hash;
+    std::string block;
+    status = get_by_hash(db, handles[CF_TX_BLOCK], tx_hash, &block_hash);
+    if (status.ok()) // the block is keyed the same way (raw or hex) as its hash is stored here
+        status = db->Get(rocksdb::ReadOptions(), handles[0], rocksdb::Slice(block_hash), &block);
+
+    unit::DB::close_db(db, &handles);
+    if(block.empty())
+        return std::nullopt;
+
+    return block_to_json(block);
+}
+
+rocksdb::Status unit::DB::get_by_hash(rocksdb::DB *db, rocksdb::ColumnFamilyHandle *column, const unit::Hash32 &hash, std::string *value) {
+    rocksdb::Status status = db->Get(rocksdb::ReadOptions(), column, hash_key(hash), value);
+    if (status.IsNotFound())
+        status = db->Get(rocksdb::ReadOptions(), column, rocksdb::Slice(hash.to_hex()), value);
+    return status;
+}
+
+std::string unit::DB::block_to_json(const std::string &stored) {
+    if (unit::is_json_encoded(stored))
+        return stored;
+    return Block::decode(stored).to_json_with_tx_hash_only();
+}
+
+std::string unit::DB::transaction_to_json(const std::string &stored) {
+    if (unit::is_json_encoded(stored))
+        return stored;
+    return Transaction::decode(stored).to_json_string_test();
 }
 
 
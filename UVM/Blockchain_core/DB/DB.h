@@ -24,6 +24,8 @@
 #include "../Wallet/WalletAccount.h"
 #include "../Token/Token.h"
 #include "../Hex.h"
+#include "BlockExecutor.h"
+#include "AddressRegistry.h"
 /// utility structures
 #if defined(OS_WIN)
 #include <Windows.h>
@@ -44,6 +46,9 @@ const int cpuss = (int) std::thread::hardware_concurrency();
 #define CREATE_TOKEN 1
 #define TOKEN_TRANSFER 2
 
+#define CF_TX_BLOCK 6 // transaction hash -> hash of its block
+#define CF_ADDRESS_IDS 7 // address -> account id, u64 little-endian
+
 namespace unit {
     class DB {
     public:
@@ -52,19 +57,39 @@ namespace unit {
                                                                              rocksdb::ColumnFamilyDescriptor("tx", rocksdb::ColumnFamilyOptions()),
                                                                              rocksdb::ColumnFamilyDescriptor("height", rocksdb::ColumnFamilyOptions()),
                                                                              rocksdb::ColumnFamilyDescriptor("accountBalance", rocksdb::ColumnFamilyOptions()),
-                                                                             rocksdb::ColumnFamilyDescriptor(ROCKSDB_NAMESPACE::kDefaultColumnFamilyName, rocksdb::ColumnFamilyOptions())};
-        static bool push_block(Block block);
+                                                                             rocksdb::ColumnFamilyDescriptor(ROCKSDB_NAMESPACE::kDefaultColumnFamilyName, rocksdb::ColumnFamilyOptions()),
+                                                                             rocksdb::ColumnFamilyDescriptor("txBlock", rocksdb::ColumnFamilyOptions()),
+                                                                             rocksdb::ColumnFamilyDescriptor("addressIds", rocksdb::ColumnFamilyOptions())};
+        // column families added by newer versions are created before any read-only open expects them
+        static bool create_missing_column_families();
+        // account ids assigned before the last shutdown, must be called before any id is assigned
+        static bool load_addresses();
+        static bool push_block(Block &block); // sets the index of the first block and prev_hash
         static bool push_transactions(Block *block);
         static std::optional<std::string> get_balance(std::string &address);
+        // balances of all addresses read with one open and one MultiGet, so they come from the same state;
+        // an address without a balance gets nullopt, the whole result is nullopt when the database is unavailable
+        static std::optional<std::vector<std::optional<std::string>>> get_balances(const std::vector<std::string> &addresses);
         static std::optional<std::string> get_block_height();
         static std::optional<std::string> get_token(std::string &token_address);
-        static std::optional<std::string> find_transaction(std::string tx_hash);
+        static std::optional<std::string> find_transaction(const unit::Hash32 &tx_hash);
+        // block (with transaction hashes only) the transaction was committed in
+        static std::optional<std::string> find_transaction_block(const unit::Hash32 &tx_hash);
         static void close_db(rocksdb::DB* db, std::vector<rocksdb::ColumnFamilyHandle*> *handles);
         static void close_iterators_DB(rocksdb::DB* db, std::vector<rocksdb::ColumnFamilyHandle*> *handles, std::vector<rocksdb::Iterator*> *iterators);
 
     private:
         static std::vector<rocksdb::ColumnFamilyDescriptor> get_column_families();
         static rocksdb::Options get_db_options();
+        static BlockExecutor &executor();
+        // hashes are keyed by their 32 raw bytes, values written by older versions by their hex
+        static rocksdb::Status get_by_hash(rocksdb::DB *db, rocksdb::ColumnFamilyHandle *column, const unit::Hash32 &hash, std::string *value);
+        static inline rocksdb::Slice hash_key(const unit::Hash32 &hash) {
+            return {hash.view().data(), hash.size()};
+        }
+        // stored values are binary (older ones JSON), the API gets them as JSON
+        static std::string block_to_json(const std::string &stored);
+        static std::string transaction_to_json(const std::string &stored);
         static inline void normalize_str(std::string *str) {
             str->erase(std::remove(str->begin(), str->end(), '\"'),str->end());
         }
@@ -0,0 +1,97 @@
+#ifndef UVM_HASH32_H
+#define UVM_HASH32_H
+#include "array"
+#include "cstdint"
+#include "cstring"
+#include "functional"
+#include "optional"
+#include "ostream"
+#include "string"
+#include "string_view"
+
+namespace unit {
+    // SHA3-256 digest of transactions and blocks, kept as raw bytes. Hex ("0x" + 64 digits) is only produced
+    // and parsed at the edges: JSON views, the HTTP API and values written by older versions.
+    struct Hash32 {
+        static constexpr std::size_t SIZE = 32;
+
+        std::array<uint8_t, SIZE> bytes{};
+
+        [[nodiscard]] uint8_t *data() { return bytes.data(); }
+        [[nodiscard]] const uint8_t *data() const { return bytes.data(); }
+        [[nodiscard]] constexpr std::size_t size() const { return SIZE; }
+        // raw bytes, e.g. as a RocksDB key
+        [[nodiscard]] std::string_view view() const { return {reinterpret_cast<const char *>(bytes.data()), SIZE}; }
+
+        [[nodiscard]] bool is_zero() const {
+            static const std::array<uint8_t, SIZE> zero{};
+            return bytes == zero;
+        }
+
+        [[nodiscard]] std::string to_hex() const {
+            static const char dec2hex[16 + 1] = "0123456789abcdef";
+            std::string hex;
+            hex.reserve(2 + 2 * SIZE);
+            hex += "0x";
+            for (uint8_t byte : bytes) {
+                hex += dec2hex[byte >> 4];
+                hex += dec2hex[byte & 15];
+            }
+            return hex;
+        }
+
+        // "0x" followed by 64 hex digits (either case), nullopt for anything else
+        static std::optional<Hash32> from_hex(std::string_view hex) {
+            if (hex.size() != 2 + 2 * SIZE || hex[0] != '0' || hex[1] != 'x')
+                return std::nullopt;
+            Hash32 hash;
+            for (std::size_t i = 0; i < SIZE; ++i) {
+                int high = hex_value(hex[2 + 2 * i]);
+                int low = hex_value(hex[3 + 2 * i]);
+                if (high < 0 || low < 0)
+                    return std::nullopt;
+                hash.bytes[i] = static_cast<uint8_t>(high << 4 | low);
+            }
+            return hash;
+        }
+
+        // exactly SIZE raw bytes, nullopt otherwise
+        static std::optional<Hash32> from_bytes(std::string_view raw) {
+            if (raw.size() != SIZE)
+                return std::nullopt;
+            Hash32 hash;
+            std::memcpy(hash.bytes.data(), raw.data(), SIZE);
+            return hash;
+        }
+
+        bool operator==(const Hash32 &rhs) const { return std::memcmp(bytes.data(), rhs.bytes.data(), SIZE) == 0; }
+        bool operator!=(const Hash32 &rhs) const { return !(*this == rhs); }
+        bool operator<(const Hash32 &rhs) const { return std::memcmp(bytes.data(), rhs.bytes.data(), SIZE) < 0; }
+
+        friend std::ostream &operator<<(std::ostream &out, const Hash32 &hash) {
+            return out << hash.to_hex();
+        }
+
+    private:
+        static int hex_value(char c) {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+    };
+}
+
+namespace std {
+    // digests are uniformly distributed already, any 8 bytes make a good bucket hash
+    template <>
+    struct hash<unit::Hash32> {
+        std::size_t operator()(const unit::Hash32 &hash) const noexcept {
+            std::size_t value;
+            std::memcpy(&value, hash.data(), sizeof(value));
+            return value;
+        }
+    };
+}
+
+#endif //UVM_HASH32_H
@@ -0,0 +1,389 @@
+#include "Mempool.h"
+#include "sstream"
+#include "../../ENV/env.h"
+
+Mempool::Mempool() : Mempool(unit::env_u64("UNIT_MEMPOOL_MAX_BYTES", MEMPOOL_MAX_BYTES),
+                             std::chrono::milliseconds(unit::env_u64("UNIT_MEMPOOL_TTL_MS", MEMPOOL_TX_TTL_MS))) {}
+
+Mempool::Mempool(std::size_t max_bytes, std::chrono::milliseconds ttl) : max_bytes(max_bytes), ttl(ttl) {}
+
+Mempool::~Mempool() = default;
+
+double Mempool::fee_rate(const Transaction &tx, std::size_t tx_size) {
+    return tx.fee / static_cast<double>(tx_size == 0 ? 1 : tx_size);
+}
+
+Mempool::InsertResult Mempool::insert(Transaction &&tx, uint64_t account_nonce) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return insert_locked(std::move(tx), account_nonce);
+}
+
+Mempool::InsertResult Mempool::replace(const unit::Hash32 &replaced_hash, Transaction &&tx) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return replace_locked(replaced_hash, std::move(tx));
+}
+
+void Mempool::insert_batch(std::vector<Admission> &batch) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (Admission &admission : batch)
+        admission.result = admission.replaces.is_zero() ? insert_locked(std::move(admission.tx), admission.account_nonce)
+                                                        : replace_locked(admission.replaces, std::move(admission.tx));
+}
+
+// caller holds the mutex
+Mempool::InsertResult Mempool::insert_locked(Transaction &&tx, uint64_t account_nonce) {
+    if (this->by_hash.find(tx.hash) != this->by_hash.end()) {
+        this->counters.duplicates.fetch_add(1, std::memory_order_relaxed);
+        return DUPLICATE;
+    }
+
+    const std::string &sender = tx.from;
+    uint64_t next_nonce = account_nonce;
+    auto in_flight_nonce = this->in_flight.find(sender);
+    if (in_flight_nonce != this->in_flight.end())
+        next_nonce = std::max(next_nonce, in_flight_nonce->second);
+    const SenderQueue *own = nullptr;
+    auto existing = this->senders.find(sender);
+    if (existing != this->senders.end()) {
+        if (existing->second.slots.find(tx.nonce) != existing->second.slots.end())
+            return replace_entry(&existing->second, tx.nonce, std::move(tx)); // same nonce is pending
+        next_nonce = existing->second.next_nonce;
+        own = &existing->second;
+    }
+    if (tx.nonce < next_nonce)
+        return NONCE_TOO_LOW;
+
+    std::size_t tx_size = tx.size_in_bytes();
+    double rate = fee_rate(tx, tx_size);
+    if (!make_room(tx_size, rate, own, tx.nonce)) {
+        this->counters.rejected_full.fetch_add(1, std::memory_order_relaxed);
+        return POOL_FULL;
+    }
+
+    if (this->journal != nullptr)
+        this->journal->append_insert(tx);
+
+    auto [created, inserted] = this->senders.try_emplace(sender);
+    SenderQueue &queue = created->second;
+    if (inserted) {
+        queue.sender = sender;
+        queue.next_nonce = next_nonce;
+    }
+    uint64_t slot = tx.nonce;
+    uint64_t arrival = this->arrival_counter++;
+    unit::Hash32 hash = tx.hash;
+    queue.slots.emplace(slot, Entry{std::move(tx), rate, arrival, tx_size, std::chrono::steady_clock::now()});
+    this->by_hash.emplace(std::move(hash), std::make_pair(&queue, slot));
+    this->by_fee.emplace(rate, arrival, &queue, slot);
+    this->by_age.emplace(arrival, std::make_pair(&queue, slot));
+    update_readiness(&queue);
+
+    this->count.fetch_add(1, std::memory_order_relaxed);
+    this->total_bytes.fetch_add(tx_size, std::memory_order_relaxed);
+    this->counters.added.fetch_add(1, std::memory_order_relaxed);
+    this->changed.notify_all();
+    return ADDED;
+}
+
+// caller holds the mutex
+Mempool::InsertResult Mempool::replace_locked(const unit::Hash32 &replaced_hash, Transaction &&tx) {
+    if (this->by_hash.find(tx.hash) != this->by_hash.end()) {
+        this->counters.duplicates.fetch_add(1, std::memory_order_relaxed);
+        return DUPLICATE;
+    }
+    auto found = this->by_hash.find(replaced_hash);
+    if (found == this->by_hash.end())
+        return NOT_FOUND;
+
+    SenderQueue *queue = found->second.first;
+    uint64_t slot = found->second.second;
+    if (queue->slots.at(slot).tx.from != tx.from || tx.nonce != slot)
+        return NOT_FOUND;
+    return replace_entry(queue, slot, std::move(tx));
+}
+
+// caller holds the mutex
+Mempool::InsertResult Mempool::replace_entry(SenderQueue *queue, uint64_t slot, Transaction &&tx) {
+    Entry &entry = queue->slots.at(slot);
+    std::size_t tx_size = tx.size_in_bytes();
+    double rate = fee_rate(tx, tx_size);
+    if (rate < entry.fee_rate * MEMPOOL_REPLACE_BUMP || tx.fee <= entry.tx.fee)
+        return UNDERPRICED;
+    // a bigger replacement may push the pool over its budget, room is made before anything changes
+    if (tx_size > entry.size && !make_room(tx_size - entry.size, rate, queue, slot)) {
+        this->counters.rejected_full.fetch_add(1, std::memory_order_relaxed);
+        return POOL_FULL;
+    }
+
+    if (this->journal != nullptr)
+        this->journal->append_replace(entry.tx.hash, tx);
+
+    this->by_hash.erase(entry.tx.hash);
+    this->by_fee.erase(FeeKey(entry.fee_rate, entry.arrival, queue, slot));
+    this->by_age.erase(entry.arrival);
+    this->total_bytes.fetch_sub(entry.size, std::memory_order_relaxed);
+
+    unit::Hash32 hash = tx.hash;
+    entry = Entry{std::move(tx), rate, this->arrival_counter++, tx_size, std::chrono::steady_clock::now()};
+    this->by_hash.emplace(std::move(hash), std::make_pair(queue, slot));
+    this->by_fee.emplace(entry.fee_rate, entry.arrival, queue, slot);
+    this->by_age.emplace(entry.arrival, std::make_pair(queue, slot));
+    this->total_bytes.fetch_add(tx_size, std::memory_order_relaxed);
+    if (queue->heap_index != npos && queue->slots.begin()->first == slot)
+        sift_up(queue->heap_index); // head got more expensive
+    this->counters.replaced.fetch_add(1, std::memory_order_relaxed);
+    this->changed.notify_all();
+    return REPLACED;
+}
+
+std::vector<Transaction> Mempool::pop_best(std::size_t n, std::size_t max_bytes) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::vector<Transaction> best;
+    best.reserve(std::min(n, this->count.load(std::memory_order_relaxed)));
+    std::size_t taken_bytes = 0;
+
+    while (best.size() < n && !this->heap.empty()) {
+        SenderQueue *queue = this->heap.front();
+        auto head = queue->slots.begin();
+        if (taken_bytes + head->second.size > max_bytes)
+            break;
+        taken_bytes += head->second.size;
+        queue->next_nonce = head->first + 1;
+        this->in_flight[queue->sender] = queue->next_nonce;
+        account_removed(queue, head->first, head->second);
+        best.emplace_back(std::move(head->second.tx));
+        queue->slots.erase(head);
+
+        if (queue->slots.empty()) {
+            heap_erase(0);
+            std::string sender = queue->sender; // queue is owned by senders, don't erase by a reference into it
+            this->senders.erase(sender);
+        } else if (queue->slots.begin()->first == queue->next_nonce) {
+            sift_down(0); // next transaction of the same sender becomes the head
+        } else {
+            heap_erase(0); // waits until the missing nonce arrives
+        }
+    }
+    return best;
+}
+
+void Mempool::block_committed(const std::vector<Included> &transactions) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (const Included &included : transactions) {
+        auto in_flight_nonce = this->in_flight.find(included.sender);
+        if (in_flight_nonce != this->in_flight.end()) {
+            if (in_flight_nonce->second == included.nonce + 1)
+                this->in_flight.erase(in_flight_nonce);
+            else if (!included.executed && in_flight_nonce->second > included.nonce)
+                in_flight_nonce->second = included.nonce;
+        }
+        if (included.executed)
+            continue;
+        // the sender's sequence stopped at this nonce, later transactions wait until it is sent again
+        auto queue = this->senders.find(included.sender);
+        if (queue != this->senders.end() && queue->second.next_nonce > included.nonce) {
+            queue->second.next_nonce = included.nonce;
+            update_readiness(&queue->second);
+        }
+    }
+}
+
+std::pair<uint64_t, uint64_t> Mempool::nonce_range(const std::string &sender, uint64_t account_nonce) const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    uint64_t lowest = account_nonce;
+    auto in_flight_nonce = this->in_flight.find(sender);
+    if (in_flight_nonce != this->in_flight.end())
+        lowest = std::max(lowest, in_flight_nonce->second);
+    auto queue = this->senders.find(sender);
+    if (queue == this->senders.end())
+        return {lowest, lowest};
+    lowest = std::max(lowest, queue->second.next_nonce);
+    uint64_t next = lowest;
+    while (queue->second.slots.find(next) != queue->second.slots.end())
+        next++;
+    return {lowest, next};
+}
+
+bool Mempool::wait_until_ready(std::size_t txs, std::size_t bytes, std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    return this->changed.wait_until(lock, deadline, [&] {
+        return ready_for(txs, bytes);
+    });
+}
+
+// Only transactions a block could take count: the run of consecutive nonces from the head of every ready queue,
+// anything behind a nonce gap waits. Stops as soon as a limit is reached, so it looks at no more than txs entries.
+bool Mempool::ready_for(std::size_t txs, std::size_t bytes) const {
+    std::size_t ready_txs = 0;
+    std::size_t ready_bytes = 0;
+    for (const SenderQueue *queue : this->heap) {
+        uint64_t expected = queue->next_nonce;
+        for (auto it = queue->slots.begin(); it != queue->slots.end() && it->first == expected; ++it, ++expected) {
+            ready_txs++;
+            ready_bytes += it->second.size;
+            if (ready_txs >= txs || ready_bytes >= bytes)
+                return true;
+        }
+    }
+    return false;
+}
+
+std::size_t Mempool::evict_expired() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto deadline = std::chrono::steady_clock::now() - this->ttl;
+    std::size_t before = this->count.load(std::memory_order_relaxed);
+    while (!this->by_age.empty()) {
+        auto [queue, slot] = this->by_age.begin()->second;
+        if (queue->slots.at(slot).added > deadline)
+            break;
+        erase_from(queue, slot, this->counters.evicted_expired);
+    }
+    return before - this->count.load(std::memory_order_relaxed);
+}
+
+void Mempool::attach_journal(MempoolJournal *journal) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->journal = journal;
+}
+
+bool Mempool::contains(const unit::Hash32 &hash) const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->by_hash.find(hash) != this->by_hash.end();
+}
+
+void Mempool::visit_pending(const std::string &sender, const std::function<void(const Transaction &)> &visit) const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto queue = this->senders.find(sender);
+    if (queue == this->senders.end())
+        return;
+    for (const auto &[nonce, entry] : queue->second.slots)
+        visit(entry.tx);
+}
+
+std::string Mempool::stats_to_json_string() const {
+    std::ostringstream string_stream;
+    string_stream << R"({"pending":)" << this->size() << R"(, "bytes":)" << this->bytes() << R"(, "max_bytes":)" << this->max_bytes
+                  << R"(, "added":)" << this->counters.added << R"(, "replaced":)" << this->counters.replaced
+                  << R"(, "duplicates":)" << this->counters.duplicates << R"(, "rejected_full":)" << this->counters.rejected_full
+                  << R"(, "evicted_full":)" << this->counters.evicted_full << R"(, "evicted_expired":)" << this->counters.evicted_expired << "}";
+    return string_stream.str();
+}
+
+// Evicts cheapest transactions until `needed` more bytes fit. Fails when the incoming transaction would itself be
+// the cheapest one to evict. Nonces up to own_nonce of the incoming transaction's sender (own) are never evicted:
+// the incoming transaction could not become ready without them, and the one it replaces is among them.
+bool Mempool::make_room(std::size_t needed, double rate, const SenderQueue *own, uint64_t own_nonce) {
+    if (needed > this->max_bytes)
+        return false;
+    while (this->total_bytes.load(std::memory_order_relaxed) + needed > this->max_bytes) {
+        auto cheapest = this->by_fee.begin();
+        while (cheapest != this->by_fee.end() && std::get<2>(*cheapest) == own && std::get<3>(*cheapest) <= own_nonce)
+            ++cheapest;
+        if (cheapest == this->by_fee.end() || std::get<0>(*cheapest) >= rate)
+            return false;
+        erase_from(std::get<2>(*cheapest), std::get<3>(*cheapest), this->counters.evicted_full);
+    }
+    return true;
+}
+
+// Drops slot together with every later transaction of the same sender, they were queued behind it.
+void Mempool::erase_from(SenderQueue *queue, uint64_t slot, std::atomic<uint64_t> &counter) {
+    std::vector<unit::Hash32> removed;
+    auto it = queue->slots.find(slot);
+    while (it != queue->slots.end()) {
+        removed.push_back(it->second.tx.hash);
+        account_removed(queue, it->first, it->second);
+        counter.fetch_add(1, std::memory_order_relaxed);
+        it = queue->slots.erase(it);
+    }
+    if (queue->slots.empty()) {
+        if (queue->heap_index != npos)
+            heap_erase(queue->heap_index);
+        std::string sender = queue->sender; // queue is owned by senders, don't erase by a reference into it
+        this->senders.erase(sender);
+    }
+    if (this->journal != nullptr)
+        this->journal->remove(removed); // evicted or expired, must not come back on restart
+}
+
+void Mempool::account_removed(SenderQueue *queue, uint64_t slot, const Entry &entry) {
+    this->by_hash.erase(entry.tx.hash);
+    this->by_fee.erase(FeeKey(entry.fee_rate, entry.arrival, queue, slot));
+    this->by_age.erase(entry.arrival);
+    this->count.fetch_sub(1, std::memory_order_relaxed);
+    this->total_bytes.fetch_sub(entry.size, std::memory_order_relaxed);
+}
+
+// A queue is in the heap exactly when its head carries the sender's next nonce.
+void Mempool::update_readiness(SenderQueue *queue) {
+    bool ready = !queue->slots.empty() && queue->slots.begin()->first == queue->next_nonce;
+    if (ready && queue->heap_index == npos)
+        heap_push(queue);
+    else if (!ready && queue->heap_index != npos)
+        heap_erase(queue->heap_index);
+}
+
+bool Mempool::higher(const SenderQueue *a, const SenderQueue *b) const {
+    const Entry &head_a = a->slots.begin()->second;
+    const Entry &head_b = b->slots.begin()->second;
+    if (head_a.fee_rate != head_b.fee_rate)
+        return head_a.fee_rate > head_b.fee_rate;
+    return head_a.arrival < head_b.arrival; // FIFO between equal fee rates
+}
+
+void Mempool::heap_push(SenderQueue *queue) {
+    queue->heap_index = this->heap.size();
+    this->heap.push_back(queue);
+    sift_up(queue->heap_index);
+}
+
+void Mempool::heap_erase(std::size_t index) {
+    this->heap[index]->heap_index = npos;
+    if (index == this->heap.size() - 1) {
+        this->heap.pop_back();
+        return;
+    }
+    this->heap[index] = this->heap.back();
+    this->heap[index]->heap_index = index;
+    this->heap.pop_back();
+    heap_update(index);
+}
+
+void Mempool::heap_update(std::size_t index) {
+    if (index > 0 && higher(this->heap[index], this->heap[(index - 1) / 2]))
+        sift_up(index);
+    else
+        sift_down(index);
+}
+
+void Mempool::sift_up(std::size_t index) {
+    while (index > 0) {
+        std::size_t parent = (index - 1) / 2;
+        if (!higher(this->heap[index], this->heap[parent]))
+            return;
+        heap_swap(index, parent);
+        index = parent;
+    }
+}
+
+void Mempool::sift_down(std::size_t index) {
+    for (;;) {
+        std::size_t left = 2 * index + 1;
+        std::size_t right = left + 1;
+        std::size_t top = index;
+        if (left < this->heap.size() && higher(this->heap[left], this->heap[top]))
+            top = left;
+        if (right < this->heap.size() && higher(this->heap[right], this->heap[top]))
+            top = right;
+        if (top == index)
+            return;
+        heap_swap(index, top);
+        index = top;
+    }
+}
+
+void Mempool::heap_swap(std::size_t a, std::size_t b) {
+    std::swap(this->heap[a], this->heap[b]);
+    this->heap[a]->heap_index = a;
+    this->heap[b]->heap_index = b;
+}
@@ -0,0 +1,171 @@
+#ifndef UVM_MEMPOOL_H
+#define UVM_MEMPOOL_H
+#include "atomic"
+#include "chrono"
+#include "condition_variable"
+#include "functional"
+#include "map"
+#include "mutex"
+#include "set"
+#include "string"
+#include "tuple"
+#include "unordered_map"
+#include "vector"
+#include "../Transaction.h"
+#include "MempoolJournal.h"
+
+#define MEMPOOL_REPLACE_BUMP 1.10 // replacement must pay at least 10% higher fee rate
+#define MEMPOOL_MAX_BYTES (256ULL * 1024 * 1024)
+#define MEMPOOL_TX_TTL_MS (3ULL * 60 * 60 * 1000)
+#define MEMPOOL_NONCE_WINDOW 64 // how far past its pending transactions a sender may queue a nonce
+
+// Pending transactions ordered by fee rate.
+// Every sender has its own queue ordered by nonce, so a sender's transactions are never reordered between
+// themselves. A queue is ready when its head carries the next nonce of the sender (the account nonce, or the
+// one after the sender's transactions already taken into blocks that are not committed yet); only heads of
+// ready queues take part in an indexed max-heap keyed by fee rate. Taking the best N transactions is therefore
+// O(N log M) where M is the number of distinct senders. A transaction with the nonce of a pending one replaces
+// it by the replace-by-fee rules.
+//
+// The pool is bounded by max_bytes: when it is full the cheapest transactions (together with the later
+// transactions of the same sender) are evicted to make room, or the incoming one is rejected if it is the
+// cheapest. Transactions older than ttl are dropped by evict_expired().
+class Mempool {
+public:
+    enum InsertResult {
+        ADDED = 0,
+        REPLACED = 1,
+        UNDERPRICED = 2,   // replacement does not pay enough
+        NOT_FOUND = 3,     // transaction to replace is not in the pool
+        DUPLICATE = 4,     // same hash is already pending
+        POOL_FULL = 5,     // pool is full and transaction pays less than anything in it
+        NONCE_TOO_LOW = 6, // nonce is already used by the sender
+    };
+
+    // transaction taken by pop_best() once its block is committed
+    struct Included {
+        std::string sender;
+        uint64_t nonce;
+        bool executed;
+    };
+
+    // one transaction of insert_batch(), the transaction is moved out and the result filled in
+    struct Admission {
+        Transaction tx;
+        uint64_t account_nonce = 0; // sender's nonce in the committed state
+        unit::Hash32 replaces; // pending transaction to replace-by-fee, zero to insert
+        InsertResult result = ADDED;
+    };
+
+    struct Stats {
+        std::atomic<uint64_t> added{0};
+        std::atomic<uint64_t> replaced{0};
+        std::atomic<uint64_t> duplicates{0};
+        std::atomic<uint64_t> rejected_full{0};
+        std::atomic<uint64_t> evicted_full{0};
+        std::atomic<uint64_t> evicted_expired{0};
+    };
+
+    Mempool();
+    Mempool(std::size_t max_bytes, std::chrono::milliseconds ttl);
+    virtual ~Mempool();
+
+    // account_nonce is the sender's nonce in the committed state
+    InsertResult insert(Transaction &&tx, uint64_t account_nonce = 0);
+    // replace-by-fee: tx takes the slot of pending transaction replaced_hash with the same sender and nonce
+    InsertResult replace(const unit::Hash32 &replaced_hash, Transaction &&tx);
+    // inserts or replaces every transaction in order, under a single acquisition of the pool lock
+    void insert_batch(std::vector<Admission> &batch);
+    // best transactions, at most n of them and at most max_bytes in total
+    std::vector<Transaction> pop_best(std::size_t n, std::size_t max_bytes = static_cast<std::size_t>(-1));
+    // blocks until at least txs transactions or bytes bytes are ready to be taken into a block, or until deadline;
+    // true if reached
+    bool wait_until_ready(std::size_t txs, std::size_t bytes, std::chrono::steady_clock::time_point deadline);
+    std::size_t evict_expired();
+    // the block with these transactions is committed, the chain state is authoritative for their senders again
+    void block_committed(const std::vector<Included> &transactions);
+    // (lowest nonce the sender may still use, nonce after its pending transactions)
+    std::pair<uint64_t, uint64_t> nonce_range(const std::string &sender, uint64_t account_nonce) const;
+    bool contains(const unit::Hash32 &hash) const;
+    // calls visit for every pending transaction of sender in nonce order, under the pool lock
+    void visit_pending(const std::string &sender, const std::function<void(const Transaction &)> &visit) const;
+    // accepted inserts and replacements are logged to journal from now on
+    void attach_journal(MempoolJournal *journal);
+
+    [[nodiscard]] inline std::size_t size() const {
+        return this->count.load(std::memory_order_relaxed);
+    }
+    [[nodiscard]] inline std::size_t bytes() const {
+        return this->total_bytes.load(std::memory_order_relaxed);
+    }
+    [[nodiscard]] inline std::size_t max_size_bytes() const {
+        return this->max_bytes;
+    }
+    [[nodiscard]] inline const Stats &stats() const {
+        return this->counters;
+    }
+    [[nodiscard]] std::string stats_to_json_string() const;
+
+    static double fee_rate(const Transaction &tx, std::size_t tx_size);
+
+private:
+    struct SenderQueue;
+
+    struct Entry {
+        Transaction tx;
+        double fee_rate;
+        uint64_t arrival;
+        std::size_t size;
+        std::chrono::steady_clock::time_point added;
+    };
+
+    struct SenderQueue {
+        std::string sender;
+        std::map<uint64_t, Entry> slots; // nonce -> transaction
+        uint64_t next_nonce = 0; // nonce the next transaction taken into a block must have
+        std::size_t heap_index = npos; // npos unless the queue is ready
+    };
+
+    // (fee rate, arrival, queue, nonce): cheapest transaction first
+    typedef std::tuple<double, uint64_t, SenderQueue *, uint64_t> FeeKey;
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    const std::size_t max_bytes;
+    const std::chrono::milliseconds ttl;
+
+    std::unordered_map<std::string, SenderQueue> senders; // by address, a sender gets no account id before it is written
+    std::unordered_map<unit::Hash32, std::pair<SenderQueue *, uint64_t>> by_hash; // tx hash -> (sender queue, nonce)
+    std::set<FeeKey> by_fee;
+    std::map<uint64_t, std::pair<SenderQueue *, uint64_t>> by_age; // arrival -> (sender queue, nonce), oldest first
+    std::unordered_map<std::string, uint64_t> in_flight; // sender -> nonce after its transactions in uncommitted blocks
+    std::vector<SenderQueue *> heap;
+    uint64_t arrival_counter = 0;
+    std::atomic<std::size_t> count{0};
+    std::atomic<std::size_t> total_bytes{0};
+    Stats counters;
+    MempoolJournal *journal = nullptr;
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+
+    // caller holds the mutex
+    InsertResult insert_locked(Transaction &&tx, uint64_t account_nonce);
+    InsertResult replace_locked(const unit::Hash32 &replaced_hash, Transaction &&tx);
+    InsertResult replace_entry(SenderQueue *queue, uint64_t slot, Transaction &&tx);
+    void update_readiness(SenderQueue *queue);
+    [[nodiscard]] bool ready_for(std::size_t txs, std::size_t bytes) const;
+    bool make_room(std::size_t needed, double rate, const SenderQueue *own, uint64_t own_nonce);
+    void erase_from(SenderQueue *queue, uint64_t slot, std::atomic<uint64_t> &counter);
+    void account_removed(SenderQueue *queue, uint64_t slot, const Entry &entry);
+
+    [[nodiscard]] bool higher(const SenderQueue *a, const SenderQueue *b) const;
+    void heap_push(SenderQueue *queue);
+    void heap_erase(std::size_t index);
+    void heap_update(std::size_t index);
+    void sift_up(std::size_t index);
+    void sift_down(std::size_t index);
+    void heap_swap(std::size_t a, std::size_t b);
+};
+
+
+#endif //UVM_MEMPOOL_H
@@ -0,0 +1,318 @@
+#include "MempoolJournal.h"
+#include "Mempool.h"
+#include "algorithm"
+#include "cstring"
+#include "filesystem"
+#include "iomanip"
+#include "stdexcept"
+#include "sstream"
+#include "boost/crc.hpp"
+#include "../../ENV/env.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MempoolJournal::MempoolJournal() : MempoolJournal(unit::env_string("UNIT_MEMPOOL_JOURNAL_DIR", MEMPOOL_JOURNAL_DIR),
+                                                  unit::env_u64("UNIT_MEMPOOL_SEGMENT_BYTES", MEMPOOL_JOURNAL_SEGMENT_BYTES),
+                                                  std::chrono::milliseconds(unit::env_u64("UNIT_MEMPOOL_TTL_MS", MEMPOOL_TX_TTL_MS))) {}
+
+MempoolJournal::MempoolJournal(const std::string &directory, std::size_t segment_size, std::chrono::milliseconds ttl)
+        : directory(directory), segment_size(segment_size), ttl(ttl) {}
+
+MempoolJournal::~MempoolJournal() {
+    for (Segment &segment : this->segments)
+        close_segment(segment);
+}
+
+std::vector<Transaction> MempoolJournal::replay() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::filesystem::create_directories(this->directory);
+
+    std::vector<std::pair<uint64_t, std::string>> files;
+    for (const auto &file : std::filesystem::directory_iterator(this->directory)) {
+        if (file.path().extension() != ".journal")
+            continue;
+        try {
+            files.emplace_back(std::stoull(file.path().stem().string()), file.path().string());
+        } catch (std::exception &e) {
+            std::cout << "Skipping journal file " << file.path() << std::endl;
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    std::vector<unit::Hash32> order;
+    std::unordered_map<unit::Hash32, std::pair<uint64_t, Transaction>> pending;
+    auto add_pending = [&](uint64_t segment_id, const std::string &encoded) {
+        Transaction tx = Transaction::decode(encoded);
+        order.push_back(tx.hash);
+        unit::Hash32 hash = tx.hash;
+        pending.insert_or_assign(hash, std::make_pair(segment_id, std::move(tx)));
+    };
+
+    for (const auto &[id, path] : files) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st{};
+        if (fd < 0 || ::fstat(fd, &st) != 0) {
+            std::cout << "Error: can't open journal segment " << path << std::endl;
+            if (fd >= 0) ::close(fd);
+            continue;
+        }
+        auto size = static_cast<std::size_t>(st.st_size);
+        void *mapped = size == 0 ? MAP_FAILED : ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+
+        Segment segment;
+        segment.id = id;
+        segment.path = path;
+        segment.size = size;
+        segment.offset = size; // replayed segments are never appended to
+        segment.last_write = std::chrono::system_clock::now();
+        try {
+            auto mtime = std::filesystem::last_write_time(path);
+            segment.last_write = std::chrono::system_clock::now() - (std::filesystem::file_time_type::clock::now() - mtime);
+        } catch (std::exception &e) {}
+
+        if (mapped != MAP_FAILED) {
+            const char *data = static_cast<const char *>(mapped);
+            std::size_t position = 0;
+            while (position + HEADER_SIZE <= size && get_u32(data + position) == MAGIC) {
+                uint32_t type = get_u32(data + position + 4);
+                uint32_t length = get_u32(data + position + 8);
+                uint32_t crc = get_u32(data + position + 12);
+                if (position + HEADER_SIZE + length > size || checksum(data + position + HEADER_SIZE, length) != crc) {
+                    std::cout << "Journal segment " << path << " has a torn record at " << position << ", ignoring the rest" << std::endl;
+                    break;
+                }
+                std::string payload(data + position + HEADER_SIZE, length);
+                position += HEADER_SIZE + length;
+                try {
+                    std::size_t payload_position = 0;
+                    if (type == INSERT) {
+                        add_pending(id, payload);
+                    } else if (type == REPLACE) {
+                        pending.erase(read_hash(payload, payload_position));
+                        add_pending(id, payload.substr(payload_position));
+                    } else if (type == REMOVE) {
+                        while (payload_position < payload.size())
+                            pending.erase(read_hash(payload, payload_position));
+                    }
+                } catch (std::exception &e) {
+                    std::cout << "Error: broken journal record in " << path << ": " << e.what() << std::endl;
+                }
+            }
+            ::munmap(mapped, size);
+        }
+        this->segments.push_back(std::move(segment));
+        this->next_segment_id = id + 1;
+    }
+
+    std::vector<Transaction> restored;
+    restored.reserve(pending.size());
+    for (const unit::Hash32 &hash : order) {
+        auto found = pending.find(hash);
+        if (found == pending.end())
+            continue;
+        Segment *segment = find_segment(found->second.first);
+        if (segment != nullptr)
+            segment->live++;
+        this->live_hashes.emplace(hash, found->second.first);
+        restored.emplace_back(std::move(found->second.second));
+        pending.erase(found);
+    }
+
+    open_segment(0);
+    this->replayed = true;
+    truncate();
+    std::cout << "Mempool journal: restored " << restored.size() << " pending transactions" << std::endl;
+    return restored;
+}
+
+void MempoolJournal::append_insert(const Transaction &tx) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    append(INSERT, tx.encode());
+    this->live_hashes[tx.hash] = this->segments.back().id;
+    this->segments.back().live++;
+}
+
+void MempoolJournal::append_replace(const unit::Hash32 &replaced_hash, const Transaction &tx) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::string payload;
+    append_hash(payload, replaced_hash);
+    payload.append(tx.encode());
+    append(REPLACE, payload);
+    release(replaced_hash);
+    this->live_hashes[tx.hash] = this->segments.back().id;
+    this->segments.back().live++;
+}
+
+void MempoolJournal::remove(const std::vector<unit::Hash32> &hashes) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (!this->replayed || hashes.empty())
+        return;
+    std::string payload;
+    payload.reserve(hashes.size() * (4 + unit::Hash32::SIZE));
+    for (const unit::Hash32 &hash : hashes)
+        append_hash(payload, hash);
+    append(REMOVE, payload);
+    for (const unit::Hash32 &hash : hashes)
+        release(hash);
+    truncate();
+    Segment &active = this->segments.back();
+    ::msync(active.data, active.size, MS_ASYNC);
+}
+
+// caller holds the mutex
+void MempoolJournal::append(RecordType type, const std::string &payload) {
+    std::size_t needed = HEADER_SIZE + payload.size();
+    try {
+        if (!this->replayed)
+            throw std::runtime_error("journal is not replayed yet");
+        if (this->segments.back().offset + needed > this->segments.back().size)
+            open_segment(needed);
+    } catch (std::exception &e) {
+        std::cout << "Error: mempool journal append failed: " << e.what() << std::endl;
+        return;
+    }
+
+    Segment &segment = this->segments.back();
+    char *record = segment.data + segment.offset;
+    std::memcpy(record + HEADER_SIZE, payload.data(), payload.size());
+    put_u32(record + 4, type);
+    put_u32(record + 8, static_cast<uint32_t>(payload.size()));
+    put_u32(record + 12, checksum(payload.data(), payload.size()));
+    put_u32(record, MAGIC); // written last, the record becomes visible to replay only when complete
+    segment.offset += needed;
+    segment.last_write = std::chrono::system_clock::now();
+}
+
+void MempoolJournal::open_segment(std::size_t min_size) {
+    if (!this->segments.empty())
+        close_segment(this->segments.back());
+
+    Segment segment;
+    segment.id = this->next_segment_id++;
+    std::ostringstream name;
+    name << std::setw(20) << std::setfill('0') << segment.id << ".journal";
+    segment.path = (std::filesystem::path(this->directory) / name.str()).string();
+    segment.size = std::max(this->segment_size, min_size);
+    segment.last_write = std::chrono::system_clock::now();
+
+    segment.fd = ::open(segment.path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (segment.fd < 0)
+        throw std::runtime_error("can't create " + segment.path);
+    if (::ftruncate(segment.fd, static_cast<off_t>(segment.size)) != 0) {
+        ::close(segment.fd);
+        throw std::runtime_error("can't allocate " + segment.path);
+    }
+    void *mapped = ::mmap(nullptr, segment.size, PROT_READ | PROT_WRITE, MAP_SHARED, segment.fd, 0);
+    if (mapped == MAP_FAILED) {
+        ::close(segment.fd);
+        throw std::runtime_error("can't map " + segment.path);
+    }
+    segment.data = static_cast<char *>(mapped);
+    this->segments.push_back(std::move(segment));
+}
+
+void MempoolJournal::close_segment(Segment &segment) {
+    if (segment.data != nullptr) {
+        ::msync(segment.data, segment.size, MS_ASYNC);
+        ::munmap(segment.data, segment.size);
+        segment.data = nullptr;
+    }
+    if (segment.fd >= 0) {
+        ::close(segment.fd);
+        segment.fd = -1;
+    }
+}
+
+void MempoolJournal::release(const unit::Hash32 &hash) {
+    auto found = this->live_hashes.find(hash);
+    if (found == this->live_hashes.end())
+        return;
+    Segment *segment = find_segment(found->second);
+    if (segment != nullptr && segment->live > 0)
+        segment->live--;
+    this->live_hashes.erase(found);
+}
+
+// Unlinks the oldest segments while nothing alive is left in them. Only a prefix is ever removed: a removal record
+// always lives in the same or a newer segment than the insert it cancels.
+void MempoolJournal::truncate() {
+    auto now = std::chrono::system_clock::now();
+    while (this->segments.size() > 1) {
+        Segment &oldest = this->segments.front();
+        bool expired = now - oldest.last_write > this->ttl; // mempool has evicted everything in it by now
+        if (oldest.live > 0 && !expired)
+            return;
+        if (oldest.live > 0) {
+            for (auto it = this->live_hashes.begin(); it != this->live_hashes.end();)
+                it = it->second == oldest.id ? this->live_hashes.erase(it) : std::next(it);
+        }
+        close_segment(oldest);
+        ::unlink(oldest.path.c_str());
+        this->segments.pop_front();
+    }
+}
+
+MempoolJournal::Segment *MempoolJournal::find_segment(uint64_t id) {
+    if (this->segments.empty() || id < this->segments.front().id)
+        return nullptr;
+    std::size_t index = id - this->segments.front().id; // ids are consecutive
+    if (index < this->segments.size() && this->segments[index].id == id)
+        return &this->segments[index];
+    for (Segment &segment : this->segments)
+        if (segment.id == id)
+            return &segment;
+    return nullptr;
+}
+
+void MempoolJournal::put_u32(char *dst, uint32_t value) {
+    for (int i = 0; i < 4; ++i)
+        dst[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+}
+
+uint32_t MempoolJournal::get_u32(const char *src) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i)
+        value |= static_cast<uint32_t>(static_cast<unsigned char>(src[i])) << (8 * i);
+    return value;
+}
+
+uint32_t MempoolJournal::checksum(const char *data, std::size_t size) {
+    boost::crc_32_type crc;
+    crc.process_bytes(data, size);
+    return crc.checksum();
+}
+
+void MempoolJournal::append_string(std::string &out, const std::string &value) {
+    char length[4];
+    put_u32(length, static_cast<uint32_t>(value.size()));
+    out.append(length, 4);
+    out.append(value);
+}
+
+std::string MempoolJournal::read_string(const std::string &payload, std::size_t &position) {
+    if (position + 4 > payload.size())
+        throw std::out_of_range("journal string length");
+    uint32_t length = get_u32(payload.data() + position);
+    if (position + 4 + length > payload.size())
+        throw std::out_of_range("journal string");
+    std::string value = payload.substr(position + 4, length);
+    position += 4 + length;
+    return value;
+}
+
+void MempoolJournal::append_hash(std::string &out, const unit::Hash32 &hash) {
+    char length[4];
+    put_u32(length, static_cast<uint32_t>(hash.size()));
+    out.append(length, 4);
+    out.append(hash.view());
+}
+
+unit::Hash32 MempoolJournal::read_hash(const std::string &payload, std::size_t &position) {
+    std::optional<unit::Hash32> hash = unit::Hash32::from_bytes(read_string(payload, position));
+    if (!hash.has_value())
+        throw std::invalid_argument("journal hash");
+    return hash.value();
+}
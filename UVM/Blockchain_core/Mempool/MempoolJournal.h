@@ -0,0 +1,84 @@
+#ifndef UVM_MEMPOOLJOURNAL_H
+#define UVM_MEMPOOLJOURNAL_H
+#include "chrono"
+#include "cstdint"
+#include "deque"
+#include "mutex"
+#include "string"
+#include "unordered_map"
+#include "vector"
+#include "../Transaction.h"
+
+#define MEMPOOL_JOURNAL_DIR "/tmp/unit_mempool/"
+#define MEMPOOL_JOURNAL_SEGMENT_BYTES (64ULL * 1024 * 1024)
+
+// Append-only log of the mempool so pending transactions survive a restart.
+// The log is split into fixed size memory-mapped segment files, appending a record is a memcpy into the mapping
+// (no syscall), the kernel writes pages back on its own. Every record is
+//   [u32 magic][u32 type][u32 payload length][u32 crc32(payload)][payload]
+// and a zero magic marks the end of written data, so a torn tail is detected by the checksum and ignored on replay.
+// Every transaction leaving the pool (taken into a block, evicted, expired) is tombstoned and the oldest segments
+// are unlinked once nothing alive is left in them (or they are older than the mempool TTL).
+class MempoolJournal {
+public:
+    MempoolJournal();
+    MempoolJournal(const std::string &directory, std::size_t segment_size, std::chrono::milliseconds ttl);
+    virtual ~MempoolJournal();
+
+    // Reads every segment and returns still pending transactions in journal order. Must be called once,
+    // before anything is appended.
+    std::vector<Transaction> replay();
+
+    void append_insert(const Transaction &tx);
+    void append_replace(const unit::Hash32 &replaced_hash, const Transaction &tx);
+    // the transactions left the pool: included in a block, dropped with a failed block, evicted or expired
+    void remove(const std::vector<unit::Hash32> &hashes);
+
+private:
+    enum RecordType : uint32_t {
+        INSERT = 1,
+        REPLACE = 2,
+        REMOVE = 3,
+    };
+
+    struct Segment {
+        uint64_t id;
+        std::string path;
+        int fd = -1;
+        char *data = nullptr;
+        std::size_t size = 0;
+        std::size_t offset = 0;
+        std::size_t live = 0;
+        std::chrono::system_clock::time_point last_write;
+    };
+
+    static constexpr uint32_t MAGIC = 0x4a504d55; // "UMPJ"
+    static constexpr std::size_t HEADER_SIZE = 16;
+
+    const std::string directory;
+    const std::size_t segment_size;
+    const std::chrono::milliseconds ttl;
+    std::deque<Segment> segments; // oldest first, back() is the one being appended to
+    std::unordered_map<unit::Hash32, uint64_t> live_hashes; // pending tx hash -> segment id
+    uint64_t next_segment_id = 0;
+    bool replayed = false;
+    std::mutex mutex;
+
+    void append(RecordType type, const std::string &payload);
+    void open_segment(std::size_t min_size);
+    void close_segment(Segment &segment);
+    void release(const unit::Hash32 &hash);
+    void truncate();
+    Segment *find_segment(uint64_t id);
+    static void put_u32(char *dst, uint32_t value);
+    static uint32_t get_u32(const char *src);
+    static uint32_t checksum(const char *data, std::size_t size);
+    static void append_string(std::string &out, const std::string &value);
+    static std::string read_string(const std::string &payload, std::size_t &position);
+    // length-prefixed raw bytes
+    static void append_hash(std::string &out, const unit::Hash32 &hash);
+    static unit::Hash32 read_hash(const std::string &payload, std::size_t &position);
+};
+
+
+#endif //UVM_MEMPOOLJOURNAL_H
@@ -0,0 +1,538 @@
+#include "ValidationPipeline.h"
+#include "algorithm"
+#include "cmath"
+#include "sstream"
+#include "boost/algorithm/hex.hpp"
+#include "../DB/DB.h"
+#include "../../ENV/env.h"
+
+ValidationPipeline::Stage::Stage(const char *name, std::size_t threads, std::size_t capacity, bool (ValidationPipeline::*handler)(Submission &))
+        : name(name), threads(threads == 0 ? 1 : threads), queue(capacity), handler(handler) {}
+
+ValidationPipeline::ValidationPipeline(Mempool *mempool, unit::mpsc_queue<Submission> *admitted)
+        : mempool(mempool), admitted(admitted),
+          batch_threads(std::max<std::size_t>(unit::env_u64("UNIT_PIPELINE_BATCH_THREADS", PIPELINE_BATCH_THREADS), 1)),
+          batch_limit(unit::env_u64("UNIT_PIPELINE_MAX_BATCH", PIPELINE_MAX_BATCH)),
+          batches(unit::env_u64("UNIT_PIPELINE_BATCH_QUEUE_CAPACITY", PIPELINE_BATCH_QUEUE_CAPACITY)) {
+    std::size_t cpu_threads = unit::env_u64("UNIT_PIPELINE_THREADS", std::max(1u, std::thread::hardware_concurrency() / 2));
+    std::size_t db_threads = unit::env_u64("UNIT_PIPELINE_DB_THREADS", PIPELINE_DB_THREADS);
+    std::size_t capacity = unit::env_u64("UNIT_PIPELINE_QUEUE_CAPACITY", PIPELINE_QUEUE_CAPACITY);
+    this->stages.emplace_back(new Stage("decode", cpu_threads, capacity, &ValidationPipeline::decode));
+    this->stages.emplace_back(new Stage("stateless", cpu_threads, capacity, &ValidationPipeline::check_stateless));
+    this->stages.emplace_back(new Stage("hash", cpu_threads, capacity, &ValidationPipeline::hash));
+    this->stages.emplace_back(new Stage("signature", cpu_threads, capacity, &ValidationPipeline::verify_signature));
+    this->stages.emplace_back(new Stage("stateful", db_threads, capacity, &ValidationPipeline::check_stateful));
+}
+
+ValidationPipeline::~ValidationPipeline() {
+    this->batches.close();
+    for (std::thread &worker : this->batch_workers)
+        worker.join();
+    for (auto &stage : this->stages) {
+        stage->queue.close();
+        for (std::thread &worker : stage->workers)
+            worker.join();
+    }
+}
+
+void ValidationPipeline::start() {
+    for (std::size_t i = 0; i < this->stages.size(); ++i)
+        for (std::size_t j = 0; j < this->stages[i]->threads; ++j)
+            this->stages[i]->workers.emplace_back(&ValidationPipeline::work, this, i);
+    for (std::size_t i = 0; i < this->batch_threads; ++i)
+        this->batch_workers.emplace_back(&ValidationPipeline::work_batches, this);
+}
+
+bool ValidationPipeline::submit(boost::json::value data, Callback done) {
+    Submission submission;
+    submission.data = std::move(data);
+    submission.done = std::move(done);
+    if (this->stages[DECODE]->queue.try_push(std::move(submission)))
+        return true;
+    this->refused.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool ValidationPipeline::submit_decoded(Submission submission) {
+    if (this->stages[STATELESS]->queue.try_push(std::move(submission)))
+        return true;
+    this->refused.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool ValidationPipeline::submit_batch(boost::json::array items, BatchCallback done) {
+    Batch batch{std::move(items), {}, std::move(done)};
+    if (this->batches.try_push(std::move(batch)))
+        return true;
+    this->refused.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool ValidationPipeline::submit_batch(std::vector<Submission> submissions, BatchCallback done) {
+    Batch batch{{}, std::move(submissions), std::move(done)};
+    if (this->batches.try_push(std::move(batch)))
+        return true;
+    this->refused.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool ValidationPipeline::decode_binary(const std::string &body, std::vector<Submission> &submissions, std::string &error) {
+    unit::Decoder frames(body);
+    try {
+        while (!frames.done()) {
+            uint32_t length = frames.u32();
+            unit::Decoder record = frames.frame(length);
+            uint8_t version = record.u8();
+            if (version != SUBMISSION_WIRE_VERSION) {
+                error = "Unknown record version " + std::to_string(version);
+                return false;
+            }
+            uint8_t type = record.u8();
+            std::string from = record.bytes();
+            std::string to = record.bytes();
+            double amount = record.f64();
+            double fee = record.f64();
+            uint64_t nonce = record.u64();
+            std::string sign = record.bytes();
+            unit::Hash32 replaces = record.hash();
+            unit::TxPayload payload = unit::TxPayload::decode(record);
+            if (!record.done()) {
+                error = "Record has trailing bytes";
+                return false;
+            }
+
+            Submission submission;
+            if (type == CREATE_TOKEN) // the same fields the JSON decode stage keeps
+                submission.tx = Transaction(from, "", type, std::move(payload), "0", 0);
+            else
+                submission.tx = Transaction(from, to, type, std::move(payload), "0", type == UNIT_TRANSFER ? amount : 0);
+            submission.tx.setFee(fee);
+            submission.tx.setNonce(nonce);
+            submission.signature = std::move(sign);
+            submission.replaces = replaces;
+            submissions.push_back(std::move(submission));
+        }
+    } catch (std::exception &e) {
+        error = e.what();
+        return false;
+    }
+    return true;
+}
+
+void ValidationPipeline::set_signature_verifier(SignatureVerifier verifier) {
+    this->verifier = std::move(verifier);
+}
+
+// runs check in the name of stage, a check that throws rejects the transaction
+template <class Check>
+bool ValidationPipeline::run_stage(std::size_t stage, Submission &submission, Check check) {
+    Stage &current = *this->stages[stage];
+    bool passed;
+    try {
+        passed = check();
+    } catch (const boost::wrapexcept<std::out_of_range> &o) {
+        passed = reject(submission, "Data is invalid");
+    } catch (std::exception &e) {
+        passed = reject(submission, "Invalid data");
+    }
+    (passed ? current.passed : current.rejected).fetch_add(1, std::memory_order_relaxed);
+    return passed;
+}
+
+void ValidationPipeline::work(std::size_t stage) {
+    Stage &current = *this->stages[stage];
+    Submission submission;
+    while (current.queue.pop(submission)) {
+        if (run_stage(stage, submission, [&] { return (this->*current.handler)(submission); }))
+            forward(stage, std::move(submission));
+    }
+}
+
+void ValidationPipeline::work_batches() {
+    Batch batch;
+    while (this->batches.pop(batch)) {
+        process_batch(batch);
+        this->batches_done.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ValidationPipeline::process_batch(Batch &batch) {
+    // binary submissions come decoded already
+    const bool decoded = batch.items.empty();
+    std::vector<Submission> submissions = std::move(batch.decoded);
+    const std::size_t count = decoded ? submissions.size() : batch.items.size();
+    submissions.resize(count);
+    std::vector<Verdict> verdicts(count, Verdict{false, "", unit::Hash32()});
+    std::vector<std::size_t> alive;
+    alive.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        Submission &submission = submissions[i];
+        if (!decoded)
+            submission.data = std::move(batch.items[i]);
+        submission.done = [&verdicts, i](const Verdict &verdict) { verdicts[i] = verdict; };
+        bool passed = true;
+        for (std::size_t stage = decoded ? STATELESS : DECODE; passed && stage < STATEFUL; ++stage)
+            passed = run_stage(stage, submission, [&] { return (this->*this->stages[stage]->handler)(submission); });
+        if (passed)
+            alive.push_back(i);
+    }
+
+    // every sender's balance is read once, all of them from the same state
+    std::vector<std::string> senders;
+    std::unordered_map<std::string, std::size_t> sender_index;
+    for (std::size_t i : alive)
+        if (sender_index.emplace(submissions[i].tx.from, senders.size()).second)
+            senders.push_back(submissions[i].tx.from);
+    std::optional<std::vector<std::optional<std::string>>> balances;
+    if (!senders.empty())
+        balances = unit::DB::get_balances(senders);
+
+    // the stripes of all senders of the batch are held while it is checked, always taken in the same order
+    std::vector<std::size_t> stripe_indexes;
+    for (const std::string &sender : senders)
+        stripe_indexes.push_back(stripe_of(sender));
+    std::sort(stripe_indexes.begin(), stripe_indexes.end());
+    stripe_indexes.erase(std::unique(stripe_indexes.begin(), stripe_indexes.end()), stripe_indexes.end());
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(stripe_indexes.size());
+    for (std::size_t index : stripe_indexes)
+        locks.emplace_back(this->stripes[index].mutex);
+
+    std::vector<std::optional<SenderState>> states(senders.size());
+    std::vector<Mempool::Admission> admissions;
+    std::vector<std::size_t> admitted_items;
+    std::vector<std::size_t> admitted_senders; // the transactions are moved into the mempool, their senders are kept here
+    admissions.reserve(alive.size());
+    admitted_items.reserve(alive.size());
+    admitted_senders.reserve(alive.size());
+    for (std::size_t i : alive) {
+        Submission &submission = submissions[i];
+        bool passed = run_stage(STATEFUL, submission, [&] {
+            if (!balances.has_value())
+                return reject(submission, "Storage is unavailable, please try again later");
+            std::size_t sender = sender_index.at(submission.tx.from);
+            const std::optional<std::string> &balance = (*balances)[sender];
+            if (!balance.has_value())
+                return reject(submission, "Balance not found, address: " + submission.tx.from);
+            if (!states[sender].has_value())
+                states[sender] = sender_state(submission.tx.from, balance.value());
+            return check_against(submission, states[sender].value());
+        });
+        if (!passed)
+            continue;
+        verdicts[i].hash = submission.tx.hash;
+        admitted_senders.push_back(sender_index.at(submission.tx.from));
+        admissions.push_back(Mempool::Admission{std::move(submission.tx), submission.account_nonce, submission.replaces});
+        admitted_items.push_back(i);
+    }
+    locks.clear();
+
+    this->mempool->insert_batch(admissions);
+    for (std::size_t k = 0; k < admissions.size(); ++k) {
+        std::size_t i = admitted_items[k];
+        verdicts[i] = verdict_of(admissions[k].result, verdicts[i].hash);
+        release(senders[admitted_senders[k]], verdicts[i].hash);
+    }
+    batch.done(std::move(verdicts));
+}
+
+void ValidationPipeline::forward(std::size_t stage, Submission &&submission) {
+    if (stage + 1 < this->stages.size()) {
+        if (!this->stages[stage + 1]->queue.push(std::move(submission))) // blocks while the next stage is behind
+            reject(submission, "Node is shutting down");
+        return;
+    }
+    while (!this->admitted->try_push(std::move(submission)))
+        std::this_thread::yield();
+}
+
+bool ValidationPipeline::reject(Submission &submission, const std::string &message) {
+    if (submission.done)
+        submission.done(Verdict{false, message, submission.tx.hash});
+    return false;
+}
+
+void ValidationPipeline::admit(Submission &submission) {
+    unit::Hash32 hash = submission.tx.hash;
+    std::string from = submission.tx.from;
+    Mempool::InsertResult result = submission.replaces.is_zero() ? this->mempool->insert(std::move(submission.tx), submission.account_nonce)
+                                                               : this->mempool->replace(submission.replaces, std::move(submission.tx));
+    release(from, hash); // in the pool now, or never will be
+    if (submission.done)
+        submission.done(verdict_of(result, hash));
+}
+
+ValidationPipeline::Verdict ValidationPipeline::verdict_of(Mempool::InsertResult result, const unit::Hash32 &hash) {
+    Verdict verdict{false, "", hash};
+    switch (result) {
+        case Mempool::ADDED:
+        case Mempool::REPLACED:
+            verdict.accepted = true;
+            verdict.message = "Ok";
+            break;
+        case Mempool::UNDERPRICED:
+            verdict.message = "Replacement fee is too low";
+            break;
+        case Mempool::NOT_FOUND:
+            verdict.message = "Transaction to replace not found";
+            break;
+        case Mempool::DUPLICATE:
+            verdict.message = "Transaction already pending";
+            break;
+        case Mempool::POOL_FULL:
+            verdict.message = "Transaction pool is full, please try again later";
+            break;
+        case Mempool::NONCE_TOO_LOW:
+            verdict.message = "Nonce too low";
+            break;
+    }
+    return verdict;
+}
+
+/* STAGES */
+/*--------*/
+bool ValidationPipeline::decode(Submission &submission) {
+    const boost::json::value &data = submission.data;
+    int type = boost::json::value_to<int>(data.at("type"));
+    std::string from = boost::json::value_to<std::string>(data.at("from"));
+    double fee = 0; // in subunits
+    if (data.as_object().contains("fee"))
+        fee = boost::json::value_to<double>(data.at("fee"));
+
+    unit::TxPayload payload = unit::TxPayload::from_json(data.at("extradata")); // the only time extradata is looked at as JSON
+    if (type == UNIT_TRANSFER)
+        submission.tx = Transaction(from, boost::json::value_to<std::string>(data.at("to")), UNIT_TRANSFER, std::move(payload), "0", boost::json::value_to<double>(data.at("amount")));
+    else if (type == CREATE_TOKEN)
+        submission.tx = Transaction(from, "", CREATE_TOKEN, std::move(payload), "0", 0);
+    else if (type == TOKEN_TRANSFER)
+        submission.tx = Transaction(from, boost::json::value_to<std::string>(data.at("to")), TOKEN_TRANSFER, std::move(payload), "0", 0);
+    else
+        return reject(submission, "No such type");
+    submission.tx.setFee(fee);
+    if (data.as_object().contains("nonce")) // part of the hash, so it must be set before the hash stage
+        submission.tx.setNonce(boost::json::value_to<uint64_t>(data.at("nonce")));
+
+    if (data.as_object().contains("sign"))
+        submission.signature = boost::json::value_to<std::string>(data.at("sign"));
+    if (data.as_object().contains("replaces")) {
+        std::optional<unit::Hash32> replaces = unit::Hash32::from_hex(boost::json::value_to<std::string>(data.at("replaces")));
+        if (!replaces.has_value() || replaces->is_zero())
+            return reject(submission, "'replaces' field is invalid");
+        submission.replaces = replaces.value();
+    }
+    return true;
+}
+
+bool ValidationPipeline::check_stateless(Submission &submission) {
+    const Transaction &tx = submission.tx;
+    if (tx.from.empty())
+        return reject(submission, "'from' field is invalid");
+    if (tx.fee < 0 || !std::isfinite(tx.fee))
+        return reject(submission, "'fee' field is invalid");
+
+    if (tx.type == UNIT_TRANSFER) {
+        if (tx.to.empty())
+            return reject(submission, "'to' field is invalid");
+        if (tx.amount < 0 || !std::isfinite(tx.amount))
+            return reject(submission, "Invalid amount");
+    } else if (tx.type == CREATE_TOKEN) {
+        const std::string &bytecode = tx.payload.bytecode();
+        if (bytecode.empty())
+            return reject(submission, "'bytecode' field is invalid");
+        std::string decoded_bytecode;
+        try {
+            decoded_bytecode = boost::algorithm::unhex(bytecode);
+        } catch (const boost::algorithm::hex_decode_error &e) {
+            return reject(submission, "Bytecode decoding error");
+        }
+
+        boost::json::error_code ec;
+        boost::json::value bytecode_to_json = boost::json::parse(decoded_bytecode, ec);
+        if (ec)
+            return reject(submission, "Failed to parse bytecode to JSON");
+        std::string name;
+        try {
+            name = boost::json::value_to<std::string>(bytecode_to_json.at("name"));
+            boost::json::value_to<double>(bytecode_to_json.at("supply"));
+        } catch (const boost::wrapexcept<std::out_of_range> &e) {
+            return reject(submission, "Not enough fields in bytecode data");
+        }
+        if (name.empty())
+            return reject(submission, "Bytecode error: 'name' is empty");
+    } else if (tx.type == TOKEN_TRANSFER) {
+        if (tx.to.empty())
+            return reject(submission, "'to' field is invalid");
+        if (tx.payload.name().empty())
+            return reject(submission, "'name' field is invalid");
+        if (tx.payload.value().empty())
+            return reject(submission, "'value' field is invalid");
+        if (!tx.payload.token_amount().has_value())
+            return reject(submission, "'value' field is not a number");
+    } else {
+        return reject(submission, "No such type"); // binary submissions skip the decode stage
+    }
+    return true;
+}
+
+bool ValidationPipeline::hash(Submission &submission) {
+    submission.tx.generate_tx_hash();
+    return true;
+}
+
+// no signature scheme is enforced unless a verifier is installed
+bool ValidationPipeline::verify_signature(Submission &submission) {
+    if (!this->verifier)
+        return true;
+    if (!this->verifier(submission.tx, submission.signature))
+        return reject(submission, "Invalid signature");
+    submission.tx.setSign(submission.signature);
+    return true;
+}
+
+bool ValidationPipeline::check_stateful(Submission &submission) {
+    std::string from = submission.tx.from;
+    std::optional<std::string> u_balance = unit::DB::get_balance(from);
+    if (!u_balance.has_value())
+        return reject(submission, "Balance not found, address: " + from);
+    std::lock_guard<std::mutex> lock(this->stripes[stripe_of(from)].mutex);
+    SenderState sender = sender_state(from, u_balance.value());
+    return check_against(submission, sender);
+}
+
+ValidationPipeline::SenderState ValidationPipeline::sender_state(const std::string &from, const std::string &balance) {
+    SenderState sender;
+    sender.balance = boost::json::parse(balance);
+    sender.account_nonce = WalletAccount::getNonce(sender.balance);
+    std::pair<uint64_t, uint64_t> nonces = this->mempool->nonce_range(from, sender.account_nonce);
+    sender.lowest_nonce = nonces.first;
+    sender.next_nonce = nonces.second;
+    // the balance is shared with the sender's pending and reserved transactions, they are spent already
+    this->mempool->visit_pending(from, [&sender](const Transaction &tx) {
+        sender.by_nonce[tx.nonce] = spend_of(tx);
+    });
+    SenderStripe &stripe = this->stripes[stripe_of(from)];
+    auto reserved = stripe.reserved.find(from);
+    if (reserved != stripe.reserved.end()) {
+        for (const Reservation &reservation : reserved->second) {
+            // a reservation may still have to replace the pending transaction, the larger spend counts
+            auto [found, created] = sender.by_nonce.try_emplace(reservation.nonce, reservation.spend);
+            if (!created && found->second.units < reservation.spend.units)
+                found->second = reservation.spend;
+        }
+        while (sender.by_nonce.count(sender.next_nonce))
+            ++sender.next_nonce;
+    }
+    for (const auto &[nonce, spend] : sender.by_nonce) {
+        sender.spent += spend.units;
+        if (!spend.token.empty())
+            sender.tokens_spent[spend.token] += spend.token_amount;
+    }
+    return sender;
+}
+
+std::size_t ValidationPipeline::stripe_of(const std::string &from) const {
+    return std::hash<std::string>()(from) % PIPELINE_SENDER_STRIPES;
+}
+
+void ValidationPipeline::release(const std::string &from, const unit::Hash32 &hash) {
+    SenderStripe &stripe = this->stripes[stripe_of(from)];
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    auto reserved = stripe.reserved.find(from);
+    if (reserved == stripe.reserved.end())
+        return;
+    std::vector<Reservation> &list = reserved->second;
+    list.erase(std::remove_if(list.begin(), list.end(), [&hash](const Reservation &reservation) { return reservation.hash == hash; }), list.end());
+    if (list.empty())
+        stripe.reserved.erase(reserved);
+}
+
+ValidationPipeline::Spend ValidationPipeline::spend_of(const Transaction &tx) {
+    Spend spend;
+    spend.units = tx.fee / SUBUNITS_PER_UNIT;
+    if (tx.type == UNIT_TRANSFER)
+        spend.units += tx.amount;
+    if (tx.type == TOKEN_TRANSFER && tx.payload.token_amount().has_value()) {
+        spend.token = tx.payload.name();
+        spend.token_amount = tx.payload.token_amount().value();
+    }
+    return spend;
+}
+
+bool ValidationPipeline::check_against(Submission &submission, SenderState &sender) {
+    const Transaction &tx = submission.tx;
+    submission.account_nonce = sender.account_nonce;
+    if (tx.nonce < sender.lowest_nonce)
+        return reject(submission, "Nonce too low");
+    if (tx.nonce > sender.next_nonce + MEMPOOL_NONCE_WINDOW)
+        return reject(submission, "Nonce too high");
+
+    // a transaction with the nonce of a pending one takes its place, that one's spend is given back
+    Spend replaced;
+    auto same_nonce = sender.by_nonce.find(tx.nonce);
+    if (same_nonce != sender.by_nonce.end())
+        replaced = same_nonce->second;
+    double spent = sender.spent - replaced.units;
+
+    double fee = tx.fee / SUBUNITS_PER_UNIT;
+    double amount = tx.type == UNIT_TRANSFER ? tx.amount : 0;
+    if (!WalletAccount::isEnoughUnitBalance(sender.balance, spent + fee))
+        return reject(submission, "Low balance to pay fee");
+    if (tx.type == UNIT_TRANSFER && !WalletAccount::isEnoughUnitBalance(sender.balance, spent + amount + fee))
+        return reject(submission, "Low balance");
+    double token_amount = tx.type == TOKEN_TRANSFER ? tx.payload.token_amount().value() : 0;
+    double tokens_spent = 0;
+    if (tx.type == TOKEN_TRANSFER) {
+        tokens_spent = sender.tokens_spent[tx.payload.name()] - (replaced.token == tx.payload.name() ? replaced.token_amount : 0);
+        if (!WalletAccount::isEnoughTokenBalance(sender.balance, tx.payload.name(), tokens_spent + token_amount))
+            return reject(submission, "Low balance");
+    }
+
+    std::vector<Reservation> &reserved = this->stripes[stripe_of(tx.from)].reserved[tx.from];
+    bool in_flight = std::any_of(reserved.begin(), reserved.end(), [&tx](const Reservation &reservation) { return reservation.hash == tx.hash; });
+    if (in_flight || this->mempool->contains(tx.hash)) {
+        if (reserved.empty())
+            this->stripes[stripe_of(tx.from)].reserved.erase(tx.from);
+        return reject(submission, "Transaction already pending");
+    }
+
+    // later transactions of a batch are checked as if this one was in the pool already
+    if (tx.nonce == sender.next_nonce)
+        ++sender.next_nonce;
+    if (!replaced.token.empty())
+        sender.tokens_spent[replaced.token] -= replaced.token_amount;
+    sender.spent = spent + amount + fee;
+    if (tx.type == TOKEN_TRANSFER)
+        sender.tokens_spent[tx.payload.name()] += token_amount;
+    sender.by_nonce[tx.nonce] = spend_of(tx);
+    reserved.push_back(Reservation{tx.hash, tx.nonce, spend_of(tx)});
+    return true;
+}
+/* END OF STAGES */
+/*---------------*/
+
+std::size_t ValidationPipeline::pending() const {
+    std::size_t pending = this->admitted->size();
+    for (const auto &stage : this->stages)
+        pending += stage->queue.size();
+    return pending;
+}
+
+std::size_t ValidationPipeline::capacity() const {
+    std::size_t capacity = this->admitted->capacity();
+    for (const auto &stage : this->stages)
+        capacity += stage->queue.capacity();
+    return capacity;
+}
+
+std::string ValidationPipeline::stats_to_json_string() const {
+    std::ostringstream string_stream;
+    string_stream << R"({"refused":)" << this->refused << R"(, "batches":{"threads":)" << this->batch_threads << R"(, "queued":)" << this->batches.size()
+                  << R"(, "done":)" << this->batches_done << R"(}, "stages":[)";
+    for (std::size_t i = 0; i < this->stages.size(); ++i) {
+        const Stage &stage = *this->stages[i];
+        string_stream << (i ? ", " : "") << R"({"name":")" << stage.name << R"(", "threads":)" << stage.threads << R"(, "queued":)" << stage.queue.size()
+                      << R"(, "passed":)" << stage.passed << R"(, "rejected":)" << stage.rejected << "}";
+    }
+    string_stream << "]}";
+    return string_stream.str();
+}
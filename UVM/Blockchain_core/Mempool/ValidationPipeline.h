@@ -0,0 +1,186 @@
+#ifndef UVM_VALIDATIONPIPELINE_H
+#define UVM_VALIDATIONPIPELINE_H
+#include "atomic"
+#include "functional"
+#include "memory"
+#include "mutex"
+#include "optional"
+#include "string"
+#include "thread"
+#include "unordered_map"
+#include "vector"
+#include "boost/json.hpp"
+#include "../Transaction.h"
+#include "Mempool.h"
+#include "../../containers/bounded_queue.h"
+#include "../../containers/mpsc_queue.h"
+
+#define PIPELINE_QUEUE_CAPACITY 4096 // per stage
+#define PIPELINE_DB_THREADS 4
+#define PIPELINE_BATCH_THREADS 2
+#define PIPELINE_BATCH_QUEUE_CAPACITY 64 // batches
+#define PIPELINE_MAX_BATCH 10000 // transactions in one batch
+#define PIPELINE_SENDER_STRIPES 64 // locks serializing the stateful checks of a sender
+#define SUBMISSION_WIRE_VERSION 1
+
+// Submitted transactions pass through stages, every stage has its own worker threads and bounded queue:
+//   decode -> stateless checks -> hash -> signature -> stateful checks -> admitted queue -> mempool
+// A transaction rejected by any stage (or by the mempool) is reported to the submitter through its callback,
+// so nothing disappears silently. When a stage falls behind, its full queue blocks the previous stage and
+// finally submit() starts refusing new transactions.
+//
+// A batch is validated as a whole by a batch worker: the stateless stages run item by item, then the balances
+// of all senders are read at once from the same state, earlier transactions of the batch count against the
+// balance and nonces of later ones, and the survivors enter the mempool in a single insert_batch().
+//
+// A transaction that passed the stateful checks is reserved until it reached the mempool (or was refused by it).
+// The checks of one sender run under its stripe lock and count the pending pool and the reservations, so two
+// submissions of a sender can never both spend the same balance.
+class ValidationPipeline {
+public:
+    struct Verdict {
+        bool accepted;
+        std::string message;
+        unit::Hash32 hash; // zero when the transaction never got hashed
+    };
+
+    // called exactly once per submitted transaction, from a pipeline or ingest thread
+    typedef std::function<void(const Verdict &)> Callback;
+    // one verdict per item of the batch, in the same order; called exactly once, from a batch worker
+    typedef std::function<void(std::vector<Verdict>)> BatchCallback;
+    // returns false when the signature does not match the transaction
+    typedef std::function<bool(const Transaction &, const std::string &)> SignatureVerifier;
+
+    struct Submission {
+        boost::json::value data;
+        Transaction tx;
+        std::string signature;
+        unit::Hash32 replaces; // hash of the pending transaction to replace-by-fee, zero when none
+        uint64_t account_nonce = 0; // sender's nonce in the committed state, filled in by the stateful stage
+        Callback done;
+    };
+
+    ValidationPipeline(Mempool *mempool, unit::mpsc_queue<Submission> *admitted);
+    virtual ~ValidationPipeline();
+
+    void start();
+    // false when the pipeline is full, done is not called in that case
+    bool submit(boost::json::value data, Callback done);
+    // already decoded transaction, enters after the decode stage
+    bool submit_decoded(Submission submission);
+    // false when too many batches are waiting, done is not called in that case
+    bool submit_batch(boost::json::array items, BatchCallback done);
+    bool submit_batch(std::vector<Submission> submissions, BatchCallback done);
+
+    // Binary submission body, for submitters that do not want to go through JSON: frames of [u32 length][record],
+    // integers little-endian and strings length-prefixed as in Codec.h.
+    //   record: u8 version, u8 type, string from, string to, f64 amount, f64 fee (subunits), u64 nonce,
+    //           string sign (empty when unsigned), 32-byte hash of the transaction to replace (zero when none),
+    //           extradata as TxPayload::encode() writes it
+    // Records decode straight into submissions; false with the reason in error when the body is malformed.
+    static bool decode_binary(const std::string &body, std::vector<Submission> &submissions, std::string &error);
+    void set_signature_verifier(SignatureVerifier verifier);
+
+    // applies the admitted transaction to the mempool and reports the verdict, called by the ingest thread
+    void admit(Submission &submission);
+
+    [[nodiscard]] std::size_t pending() const;
+    [[nodiscard]] std::size_t capacity() const; // of the queues pending() counts
+    [[nodiscard]] std::size_t max_batch() const { return batch_limit; }
+    [[nodiscard]] std::string stats_to_json_string() const;
+
+private:
+    enum StageId {
+        DECODE = 0,
+        STATELESS = 1,
+        HASH = 2,
+        SIGNATURE = 3,
+        STATEFUL = 4,
+        STAGES = 5,
+    };
+
+    struct Stage {
+        Stage(const char *name, std::size_t threads, std::size_t capacity, bool (ValidationPipeline::*handler)(Submission &));
+
+        const char *name;
+        const std::size_t threads;
+        unit::bounded_queue<Submission> queue;
+        bool (ValidationPipeline::*handler)(Submission &);
+        std::vector<std::thread> workers;
+        std::atomic<uint64_t> passed{0};
+        std::atomic<uint64_t> rejected{0};
+    };
+
+    struct Batch {
+        boost::json::array items;
+        std::vector<Submission> decoded; // binary submissions, items is empty then
+        BatchCallback done;
+    };
+
+    // what the stateful checks know about a sender, a batch updates it with every transaction it accepts
+    // what one transaction takes from its sender's balance
+    struct Spend {
+        double units = 0; // fee included
+        std::string token;
+        double token_amount = 0;
+    };
+
+    struct SenderState {
+        boost::json::value balance;
+        uint64_t account_nonce = 0;
+        uint64_t lowest_nonce = 0;
+        uint64_t next_nonce = 0; // after the sender's pending transactions and the ones accepted so far
+        double spent = 0; // units, fees included, of pending transactions and the ones accepted so far
+        std::unordered_map<std::string, double> tokens_spent;
+        std::unordered_map<uint64_t, Spend> by_nonce; // a transaction with one of these nonces replaces that spend
+    };
+
+    // passed the stateful checks, not in the mempool yet
+    struct Reservation {
+        unit::Hash32 hash;
+        uint64_t nonce;
+        Spend spend;
+    };
+
+    struct SenderStripe {
+        std::mutex mutex;
+        std::unordered_map<std::string, std::vector<Reservation>> reserved; // by sender
+    };
+
+    Mempool *mempool;
+    unit::mpsc_queue<Submission> *admitted;
+    SignatureVerifier verifier;
+    std::vector<std::unique_ptr<Stage>> stages;
+    std::atomic<uint64_t> refused{0};
+    const std::size_t batch_threads;
+    const std::size_t batch_limit;
+    unit::bounded_queue<Batch> batches;
+    std::vector<std::thread> batch_workers;
+    std::atomic<uint64_t> batches_done{0};
+    SenderStripe stripes[PIPELINE_SENDER_STRIPES];
+
+    void work(std::size_t stage);
+    template <class Check>
+    bool run_stage(std::size_t stage, Submission &submission, Check check);
+    void work_batches();
+    void process_batch(Batch &batch);
+    void forward(std::size_t stage, Submission &&submission);
+    static bool reject(Submission &submission, const std::string &message);
+
+    bool decode(Submission &submission);
+    bool check_stateless(Submission &submission);
+    bool hash(Submission &submission);
+    bool verify_signature(Submission &submission);
+    bool check_stateful(Submission &submission);
+
+    // both with the sender's stripe locked
+    SenderState sender_state(const std::string &from, const std::string &balance);
+    bool check_against(Submission &submission, SenderState &sender);
+    std::size_t stripe_of(const std::string &from) const;
+    void release(const std::string &from, const unit::Hash32 &hash);
+    static Spend spend_of(const Transaction &tx);
+    static Verdict verdict_of(Mempool::InsertResult result, const unit::Hash32 &hash);
+};
+
+
+#endif //UVM_VALIDATIONPIPELINE_H
@@ -3,43 +3,147 @@
 //
 
 #include "MerkleTree.h"
+#include "atomic"
+#include "condition_variable"
+#include "mutex"
+#include "stdexcept"
+#include "thread"
+#include "boost/asio/post.hpp"
+#include "../../ENV/env.h"
 
 MerkleTree::MerkleTree() = default;
 
-void MerkleTree::buildTree(unsigned long long int currentIndex, unsigned long long int leftQueryBorder,
-                           unsigned long long int rightQueryBorder) {
-    if (leftQueryBorder == rightQueryBorder - 1) {
-        if (leftQueryBorder < rightQueryBorder)
-            tree[currentIndex] = initial_array[leftQueryBorder];
+MerkleTree::MerkleTree(std::vector<Digest> leaves) : nodes(std::move(leaves)) {
+    this->build();
+}
+
+void MerkleTree::build() {
+    std::size_t size = this->nodes.size();
+    this->levels.push_back(0);
+    if (size == 0)
         return;
-    } else {
-        long long half = floor((rightQueryBorder + leftQueryBorder) / 2);
-        buildTree(2 * currentIndex + 1, leftQueryBorder, half);
-        buildTree(2 * currentIndex + 2, half, rightQueryBorder);
-        std::string hash_a = "0x" + this->sha3(tree[2 * currentIndex + 1]);
-        std::string hash_b = "0x" + this->sha3(tree[2 * currentIndex + 2]);
-        tree[currentIndex] = "0x" + this->sha3(concat(&hash_a, &hash_b));
+    this->nodes.reserve(2 * size); // levels never take more, so nodes don't move while workers write them
+
+    std::size_t offset = 0;
+    while (size > 1) {
+        std::size_t pairs = size / 2;
+        std::size_t parents_offset = offset + size;
+        this->nodes.resize(parents_offset + (size + 1) / 2);
+        const Digest *level = this->nodes.data() + offset;
+        Digest *parents = this->nodes.data() + parents_offset;
+
+        std::size_t workers = std::min(pool_threads(), pairs / MERKLE_MIN_PARALLEL_PAIRS);
+        if (workers == 0) {
+            hash_pairs(level, parents, 0, pairs);
+        } else {
+            std::atomic<std::size_t> next{0};
+            std::mutex mutex;
+            std::condition_variable finished;
+            std::size_t running = workers + 1; // calling thread takes pairs as well
+
+            auto work = [&] {
+                for (std::size_t first = next.fetch_add(MERKLE_CHUNK_PAIRS); first < pairs; first = next.fetch_add(MERKLE_CHUNK_PAIRS))
+                    hash_pairs(level, parents, first, std::min(first + MERKLE_CHUNK_PAIRS, pairs));
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--running == 0)
+                    finished.notify_one();
+            };
+
+            for (std::size_t i = 0; i < workers; ++i)
+                boost::asio::post(pool(), work);
+            work();
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&] { return running == 0; });
+        }
+        if (size % 2 == 1)
+            parents[pairs] = level[size - 1];
+
+        offset = parents_offset;
+        size = (size + 1) / 2;
+        this->levels.push_back(offset);
     }
 }
 
-MerkleTree::MerkleTree(const std::vector<std::string> &initialArray) : initial_array(initialArray) {
-    this->initial_array = initialArray;
-    this->tree = std::vector<std::string>((initialArray.size() * 8)); //, "0"
-    this->buildTree(0, 0, initialArray.size());
+void MerkleTree::hash_pairs(const Digest *level, Digest *parents, std::size_t first, std::size_t last) {
+    SHA3 sha3 = SHA3(SHA3::Bits256);
+    for (std::size_t i = first; i < last; ++i) {
+        sha3.reset();
+        sha3.add(level[2 * i].data(), MERKLE_DIGEST_SIZE);
+        sha3.add(level[2 * i + 1].data(), MERKLE_DIGEST_SIZE);
+        sha3.getHash(parents[i].data());
+    }
 }
 
-void MerkleTree::print_tree() {
-    for (const auto& str : this->tree) {
-        std::cout << str << std::endl;
+std::optional<MerkleTree::Digest> MerkleTree::get_root() const {
+    if (this->nodes.empty())
+        return std::nullopt;
+    return this->nodes.back();
+}
+
+std::size_t MerkleTree::leaf_count() const {
+    return this->levels.size() > 1 ? this->levels[1] : this->nodes.size();
+}
+
+const std::vector<MerkleTree::Digest> &MerkleTree::getNodes() const {
+    return nodes;
+}
+
+const std::vector<std::size_t> &MerkleTree::getLevels() const {
+    return levels;
+}
+
+std::vector<MerkleTree::ProofStep> MerkleTree::proof(std::size_t leaf) const {
+    if (leaf >= this->leaf_count())
+        throw std::out_of_range("leaf index is out of range");
+    std::vector<ProofStep> steps;
+    std::size_t index = leaf;
+    for (std::size_t level = 0; level + 1 < this->levels.size(); ++level) {
+        std::size_t size = this->levels[level + 1] - this->levels[level];
+        std::size_t sibling = index ^ 1;
+        if (sibling < size)
+            steps.push_back(ProofStep{this->nodes[this->levels[level] + sibling], sibling < index});
+        index /= 2;
     }
+    return steps;
 }
 
+bool MerkleTree::verify(const Digest &leaf, const std::vector<ProofStep> &proof, const Digest &root) {
+    SHA3 sha3 = SHA3(SHA3::Bits256);
+    Digest node = leaf;
+    for (const ProofStep &step : proof) {
+        const Digest &left = step.left ? step.sibling : node;
+        const Digest &right = step.left ? node : step.sibling;
+        sha3.reset();
+        sha3.add(left.data(), MERKLE_DIGEST_SIZE);
+        sha3.add(right.data(), MERKLE_DIGEST_SIZE);
+        sha3.getHash(node.data());
+    }
+    return node == root;
+}
 
+std::string MerkleTree::legacy_root(const std::vector<std::string> &leaves) {
+    if (leaves.empty())
+        return "";
+    SHA3 sha3 = SHA3(SHA3::Bits256);
+    return legacy_node(leaves, 0, leaves.size(), sha3);
+}
+
+// [left, right) is split in halves the same way the old segment tree did
+std::string MerkleTree::legacy_node(const std::vector<std::string> &leaves, std::size_t left, std::size_t right, SHA3 &sha3) {
+    if (left == right - 1)
+        return leaves[left];
+    std::size_t half = (left + right) / 2;
+    std::string hash_a = "0x" + sha3(legacy_node(leaves, left, half, sha3));
+    std::string hash_b = "0x" + sha3(legacy_node(leaves, half, right, sha3));
+    return "0x" + sha3(hash_a + hash_b);
+}
 
-const std::vector<std::string> &MerkleTree::getInitialArray() const {
-    return initial_array;
+std::size_t MerkleTree::pool_threads() {
+    static const std::size_t threads = unit::env_u64("UNIT_MERKLE_THREADS", std::thread::hardware_concurrency());
+    return threads;
 }
 
-void MerkleTree::setInitialArray(const std::vector<std::string> &initialArray) {
-    initial_array = initialArray;
+boost::asio::thread_pool &MerkleTree::pool() {
+    static boost::asio::thread_pool merkle_pool(std::max<std::size_t>(pool_threads(), 1));
+    return merkle_pool;
 }
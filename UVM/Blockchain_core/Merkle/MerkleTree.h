@@ -4,47 +4,56 @@
 
 #ifndef UVM_MERKLETREE_H
 #define UVM_MERKLETREE_H
-#include "iostream"
 #include "vector"
 #include "string"
-#include "cmath"
 #include "optional"
+#include "boost/asio/thread_pool.hpp"
 #include "../Crypto/SHA3/sha3.h"
+#include "../Hash32.h"
 
+#define MERKLE_DIGEST_SIZE unit::Hash32::SIZE
+#define MERKLE_MIN_PARALLEL_PAIRS 1024 // smaller levels are hashed on the calling thread
+#define MERKLE_CHUNK_PAIRS 256 // pairs taken by a worker at once
+#define MERKLE_FLAT_NET_VERSION 2 // blocks of older versions keep the legacy root
+
+// Merkle tree over raw SHA3-256 digests, stored flat level by level: leaves first, root last.
+// A parent is SHA3-256(left || right), the last node of an odd level is carried up unchanged.
+// Pairs of large levels are hashed on a shared thread pool.
 class MerkleTree {
 public:
-    MerkleTree();
+    typedef unit::Hash32 Digest;
 
-    explicit MerkleTree(const std::vector<std::string> &initialArray);
+    // one level of an inclusion proof, levels where the node is carried up have no step
+    struct ProofStep {
+        Digest sibling;
+        bool left; // sibling is the left child
+    };
 
-    static inline std::string concat(const std::string *psl,
-                             const std::string *psr) noexcept {
-        if (!(psl || psr)) return "";
-        return !psl ? *psr : !psr ? *psl : *psl + *psr;
-    }
+    MerkleTree();
+    explicit MerkleTree(std::vector<Digest> leaves);
 
-    void buildTree(unsigned long long currentIndex, unsigned long long leftQueryBorder, unsigned long long rightQueryBorder);
+    [[nodiscard]] std::optional<Digest> get_root() const;
+    [[nodiscard]] std::size_t leaf_count() const;
+    [[nodiscard]] const std::vector<Digest> &getNodes() const;
+    [[nodiscard]] const std::vector<std::size_t> &getLevels() const;
 
-    void print_tree();
-    inline std::optional<std::string> get_root(){
-        if (this->tree.empty() || this->initial_array.empty())
-            return std::nullopt;
-        return tree[0];
-    }
+    // siblings from the leaf up to the root, log2(N) digests; std::out_of_range when there is no such leaf
+    [[nodiscard]] std::vector<ProofStep> proof(std::size_t leaf) const;
+    static bool verify(const Digest &leaf, const std::vector<ProofStep> &proof, const Digest &root);
 
-    [[nodiscard]] const std::vector<std::string> &getInitialArray() const;
-    void setInitialArray(const std::vector<std::string> &initialArray);
+    // Root of blocks before MERKLE_FLAT_NET_VERSION: every node is hex, children are hashed once more and
+    // concatenated with their "0x" prefixes. Only kept to reproduce hashes of those blocks.
+    static std::string legacy_root(const std::vector<std::string> &leaves);
 
 private:
-    std::vector<std::string> initial_array;
-    std::vector<std::string> tree;
-    SHA3 sha3 = SHA3(SHA3::Bits256);
-
-protected:
-//    inline void convertToEmptyVectorByIndex() {
-//        for (long i = 0; i < initial_array.size()*8; ++i)
-//            tree.emplace_back("0");
-//    }
+    std::vector<Digest> nodes;
+    std::vector<std::size_t> levels; // offset of every level in nodes
+
+    void build();
+    static void hash_pairs(const Digest *level, Digest *parents, std::size_t first, std::size_t last);
+    static std::string legacy_node(const std::vector<std::string> &leaves, std::size_t left, std::size_t right, SHA3 &sha3);
+    static std::size_t pool_threads();
+    static boost::asio::thread_pool &pool();
 };
 
 #endif //UVM_MERKLETREE_H
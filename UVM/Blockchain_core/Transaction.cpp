@@ -27,18 +27,25 @@ void Transaction::setDate(uint64_t date) {
 }
 
 void Transaction::generate_tx_hash() {
-    std::string tx_as_str = this->to_json_string_test();
+    std::string body;
+    body.reserve(this->body_size());
+    unit::Encoder encoder(&body);
+    this->encode_body(encoder);
+
     SHA3 sha3 = SHA3(SHA3::Bits256);
-    std::string tx_hash = sha3(tx_as_str);
-    this->hash = "0x"+sha3(tx_hash);
+    unit::Hash32 tx_hash;
+    sha3.add(body.data(), body.size());
+    sha3.getHash(tx_hash.data());
+    sha3.reset();
+    sha3.add(tx_hash.data(), tx_hash.size());
+    sha3.getHash(this->hash.data());
 }
 
 std::ostream &operator<<(std::ostream &out, const Transaction &transaction) {
-    transaction.extra;
-    return out << "{\"" << transaction.from << "\", \"" << transaction.to << "\", " << transaction.type << ", " << transaction.date << ", \"" << transaction.extra.at("name") << "\", \"" << transaction.extra.at("value") << "\", " << transaction.amount <<  "}";
+    return out << "{\"" << transaction.from << "\", \"" << transaction.to << "\", " << transaction.type << ", " << transaction.date << ", \"" << transaction.payload.name() << "\", \"" << transaction.payload.value() << "\", " << transaction.amount <<  "}";
 }
 
-std::string Transaction::to_string() {
+std::string Transaction::to_string() const {
     std::ostringstream string_stream;
     string_stream << *this;
     return string_stream.str();
@@ -48,11 +55,11 @@ void Transaction::set_current_date() {
     this->date = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 }
 
-const std::string &Transaction::getHash() const {
+const unit::Hash32 &Transaction::getHash() const {
     return this->hash;
 }
 
-void Transaction::setHash(const std::string &hash) {
+void Transaction::setHash(const unit::Hash32 &hash) {
     this->hash = hash;
 }
 
@@ -69,7 +76,7 @@ bool Transaction::operator==(const Transaction &rhs) const {
             this->to == rhs.to &&
             this->type == rhs.type &&
             this->date == rhs.date &&
-            this->extra == rhs.extra &&
+            this->payload == rhs.payload &&
             this->hash == rhs.hash &&
             this->amount == rhs.amount;
 }
@@ -86,9 +93,17 @@ void Transaction::setFee(double fee) {
     this->fee = fee;
 }
 
-std::string Transaction::to_json_string() {
+uint64_t Transaction::getNonce() const {
+    return this->nonce;
+}
+
+void Transaction::setNonce(uint64_t nonce) {
+    this->nonce = nonce;
+}
+
+std::string Transaction::to_json_string() const {
     std::ostringstream string_stream;
-    string_stream << R"({"hash":")" << this->hash << R"(", "from":")" << this->from << R"(", "to":")" << this->to << R"(", "type":)" << this->type << R"(, "date":)" << this->date << R"(, "extradata":{)" << R"("name":")" << this->extra.at("name") << R"(", "value":")" << this->extra.at("value") << R"(", "bytecode":")" << this->extra.at("bytecode") << "\"}" << R"(, "sign":")" << this->sign << R"(", "block_id":")" << this->block_id << R"(", "amount":)"  << std::fixed << this->amount <<  "}";
+    string_stream << R"({"hash":")" << this->hash << R"(", "from":")" << this->from << R"(", "to":")" << this->to << R"(", "type":)" << this->type << R"(, "date":)" << this->date << R"(, "extradata":)" << boost::json::serialize(this->payload.to_json()) << R"(, "sign":")" << this->sign << R"(", "block_id":")" << this->block_id << R"(", "amount":)"  << std::fixed << this->amount << R"(, "fee":)" << this->fee << R"(, "nonce":)" << this->nonce <<  "}";
     return string_stream.str();
 }
 
@@ -173,33 +188,74 @@ bool Transaction::operator>=(const Transaction &rhs) const {
 }
 
 Transaction::Transaction(const std::string &from, const std::string &to, uint64_t type,
-                         const boost::json::value &extra, const std::string &previousHash,
-                         double amount) : from(from), to(to), type(type), extra(extra), amount(amount) {}
+                         unit::TxPayload payload, const std::string &previousHash,
+                         double amount) : from(from), to(to), type(type), payload(std::move(payload)), amount(amount) {}
 
-Transaction::Transaction(const std::string &from, const std::string &to, uint64_t type, uint64_t date, const boost::json::value &extra,
-                         const std::string &previousHash, double amount) : from(from), to(to), type(type), date(date), extra(extra),
+Transaction::Transaction(const std::string &from, const std::string &to, uint64_t type, uint64_t date, unit::TxPayload payload,
+                         const std::string &previousHash, double amount) : from(from), to(to), type(type), date(date), payload(std::move(payload)),
                                                                            amount(amount) {}
 
 Transaction::Transaction(const std::string &from, const std::string &to, uint64_t type, uint64_t date,
-                         const boost::json::value &extra, const std::string &hash, const std::string &previousHash,
-                         double amount) : from(from), to(to), type(type), date(date), extra(extra), hash(hash), amount(amount) {}
+                         unit::TxPayload payload, const unit::Hash32 &hash, const std::string &previousHash,
+                         double amount) : from(from), to(to), type(type), date(date), payload(std::move(payload)), hash(hash), amount(amount) {}
 
-std::string Transaction::to_json_string_test() {
+std::string Transaction::to_json_string_test() const {
     std::ostringstream string_stream;
-    string_stream << R"({"hash":")" << this->hash << R"(", "from":")" << this->from << R"(", "to":")" << this->to << R"(", "type":)" << this->type << R"(, "date":)" << this->date << R"(, "extradata":)" << extra << R"(, "sign":")" << this->sign << R"(", "amount":)"  << std::fixed << this->amount <<  "}";
+    string_stream << R"({"hash":")" << this->hash << R"(", "from":")" << this->from << R"(", "to":")" << this->to << R"(", "type":)" << this->type << R"(, "date":)" << this->date << R"(, "extradata":)" << boost::json::serialize(this->payload.to_json()) << R"(, "sign":")" << this->sign << R"(", "amount":)"  << std::fixed << this->amount << R"(, "fee":)" << this->fee << R"(, "nonce":)" << this->nonce <<  "}";
     return string_stream.str();
 }
 
-Transaction::Transaction(const Transaction &tx) {
-    this->from = tx.from;
-    this->to = tx.to;
-    this->date = tx.date;
-    this->amount = tx.amount;
-    this->type = tx.type;
-    this->hash = tx.hash;
-    std::cout << "tx#" << tx.hash << " extra: " << tx.extra << std::endl;
-    this->extra = tx.extra;
-    this->block_id = tx.block_id;
-    this->sign = tx.sign;
-    this->fee = tx.fee;
+std::size_t Transaction::size_in_bytes() const {
+    return sizeof(Transaction) + this->from.size() + this->to.size() + this->sign.size() + this->payload.encoded_size();
+}
+
+void Transaction::encode_body(unit::Encoder &encoder) const {
+    encoder.u8(CODEC_TX_VERSION);
+    encoder.bytes(this->from);
+    encoder.bytes(this->to);
+    encoder.u64(this->type);
+    encoder.u64(this->date);
+    this->payload.encode(encoder);
+    encoder.f64(this->amount);
+    encoder.f64(this->fee);
+    encoder.u64(this->nonce);
 }
+
+std::size_t Transaction::body_size() const {
+    return 1 + unit::Encoder::bytes_size(this->from) + unit::Encoder::bytes_size(this->to) + 8 + 8 + this->payload.encoded_size() + 8 + 8 + 8;
+}
+
+std::string Transaction::encode() const {
+    std::string encoded;
+    encoded.reserve(this->body_size() + unit::Hash32::SIZE + unit::Encoder::bytes_size(this->sign) + 8);
+    unit::Encoder encoder(&encoded);
+    this->encode_body(encoder);
+    encoder.hash(this->hash);
+    encoder.bytes(this->sign);
+    encoder.u64(this->block_id);
+    return encoded;
+}
+
+Transaction Transaction::decode(const std::string &encoded) {
+    unit::Decoder decoder(encoded);
+    uint8_t version = decoder.u8();
+    if (version != CODEC_TX_VERSION)
+        throw std::runtime_error("codec: unknown transaction version " + std::to_string(version));
+    Transaction tx;
+    tx.from = decoder.bytes();
+    tx.to = decoder.bytes();
+    tx.type = decoder.u64();
+    tx.date = decoder.u64();
+    tx.payload = unit::TxPayload::decode(decoder);
+    tx.amount = decoder.f64();
+    tx.fee = decoder.f64();
+    tx.nonce = decoder.u64();
+    tx.hash = decoder.hash();
+    tx.sign = decoder.bytes();
+    tx.block_id = decoder.u64();
+    return tx;
+}
+
+Transaction::Transaction(Transaction &&tx) noexcept = default;
+
+Transaction &Transaction::operator=(Transaction &&tx) noexcept = default;
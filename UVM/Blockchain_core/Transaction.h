@@ -9,8 +9,12 @@
 #include "iostream"
 #include <sstream>
 #include "../Blockchain_core/Crypto/SHA3/sha3.h"
+#include "Codec/Codec.h"
+#include "TxPayload.h"
 #include "boost/json.hpp"
 
+#define SUBUNITS_PER_UNIT 100000
+
 class Transaction {
 public:
     Transaction();
@@ -26,27 +30,32 @@ public:
 //                const std::string &previousHash, double amount);
 
     Transaction(const std::string &from, const std::string &to, uint64_t type,
-                const boost::json::value &extra, const std::string &previousHash, double amount);
+                unit::TxPayload payload, const std::string &previousHash, double amount);
 
-    Transaction(const std::string &from, const std::string &to, uint64_t type, uint64_t date, const boost::json::value &extra,
+    Transaction(const std::string &from, const std::string &to, uint64_t type, uint64_t date, unit::TxPayload payload,
                 const std::string &previousHash, double amount);
 
     Transaction(const std::string &from, const std::string &to, uint64_t type, uint64_t date,
-                const boost::json::value &extra, const std::string &hash, const std::string &previousHash,
+                unit::TxPayload payload, const unit::Hash32 &hash, const std::string &previousHash,
                 double amount);
-    Transaction(const Transaction &tx);
+    // move-only, so no transaction is deep-copied on its way from the request into a block
+    Transaction(const Transaction &tx) = delete;
+    Transaction(Transaction &&tx) noexcept;
+    Transaction &operator=(const Transaction &tx) = delete;
+    Transaction &operator=(Transaction &&tx) noexcept;
 
     virtual ~Transaction();
     std::string from;
     std::string to;
     uint64_t type;
     uint64_t date = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-    boost::json::value extra;
-    std::string hash;
-    uint64_t block_id;
+    unit::TxPayload payload; // extradata
+    unit::Hash32 hash;
+    uint64_t block_id = 0;
     std::string sign;
     double amount;
-    double fee; // in subunits; 1 unit = 100000 subunits;
+    double fee = 0; // in subunits; 1 unit = 100000 subunits;
+    uint64_t nonce = 0; // number of transactions sent by `from` before this one
 
 
     //  getters and setters
@@ -60,14 +69,16 @@ public:
     void setDate(uint64_t date);
     [[nodiscard]] const std::map<std::string, std::string> &getExtraData() const;
     void setExtraData(const std::map<std::string, std::string> &extraData);
-    [[nodiscard]] const std::string &getHash() const;
-    void setHash(const std::string &hash);
+    [[nodiscard]] const unit::Hash32 &getHash() const;
+    void setHash(const unit::Hash32 &hash);
     [[nodiscard]] const std::string &getPreviousHash() const;
     void setPreviousHash(const std::string &previousHash);
     [[nodiscard]] double getAmount() const;
     void setAmount(double amount);
     [[nodiscard]] double getFee() const;
     void setFee(double fee);
+    [[nodiscard]] uint64_t getNonce() const;
+    void setNonce(uint64_t nonce);
     [[nodiscard]] uint64_t getBlockId() const;
     void setBlockId(uint64_t blockId);
     [[nodiscard]] const std::string &getSign() const;
@@ -76,10 +87,17 @@ public:
     //  custom functions
     void generate_tx_hash(); // getting serializing value and make hashed it twice
     friend std::ostream& operator<< (std::ostream &out, const Transaction &transaction);
-    std::string to_string();
+    [[nodiscard]] std::string to_string() const;
     void set_current_date();
-    std::string to_json_string();
-    std::string to_json_string_test();
+    [[nodiscard]] std::string to_json_string() const;
+    [[nodiscard]] std::string to_json_string_test() const;
+    [[nodiscard]] std::size_t size_in_bytes() const; // approximate in-memory/serialized size, used for fee rate
+
+    //  binary encoding (Codec/Codec.h), JSON is only a view for the API
+    void encode_body(unit::Encoder &encoder) const; // everything covered by the hash
+    [[nodiscard]] std::size_t body_size() const;
+    [[nodiscard]] std::string encode() const; // body, hash, sign and block id; RocksDB values and the mempool journal
+    static Transaction decode(const std::string &encoded);
 
     //  boolean operators
     bool operator==(const Transaction &rhs) const;
@@ -0,0 +1,123 @@
+#include "TxPayload.h"
+#include "cmath"
+#include "cstdlib"
+
+static const unit::TxPayload::Field PAYLOAD_FIELDS[] = {unit::TxPayload::BYTECODE, unit::TxPayload::NAME, unit::TxPayload::VALUE};
+
+unit::TxPayload unit::TxPayload::from_json(const boost::json::value &extra) {
+    TxPayload payload;
+    const boost::json::object *object = extra.if_object();
+    if (object == nullptr)
+        return payload;
+    for (Field field : PAYLOAD_FIELDS) {
+        const boost::json::value *member = object->if_contains(key_of(field));
+        if (member != nullptr && member->is_string())
+            payload.set(field, std::string(member->as_string()));
+    }
+    return payload;
+}
+
+boost::json::object unit::TxPayload::to_json() const {
+    boost::json::object extra;
+    for (Field field : PAYLOAD_FIELDS)
+        if (has(field))
+            extra[key_of(field)] = text(field);
+    return extra;
+}
+
+void unit::TxPayload::set(Field field, std::string text) {
+    this->fields |= field;
+    if (field == BYTECODE) {
+        this->bytecode_ = std::move(text);
+    } else if (field == NAME) {
+        this->name_ = std::move(text);
+    } else {
+        this->value_ = std::move(text);
+        char *end = nullptr;
+        double parsed = std::strtod(this->value_.c_str(), &end);
+        if (this->value_.empty() || end != this->value_.c_str() + this->value_.size() || !std::isfinite(parsed))
+            this->token_amount_ = std::nullopt;
+        else
+            this->token_amount_ = parsed;
+    }
+}
+
+// same bytes as Encoder::json() of {"bytecode": ..., "name": ..., "value": ...} with the present fields
+void unit::TxPayload::encode(Encoder &encoder) const {
+    uint32_t count = 0;
+    for (Field field : PAYLOAD_FIELDS)
+        count += has(field) ? 1 : 0;
+    encoder.u8(TAG_OBJECT);
+    encoder.u32(count);
+    for (Field field : PAYLOAD_FIELDS) {
+        if (!has(field))
+            continue;
+        encoder.bytes(key_of(field));
+        encoder.u8(TAG_STRING);
+        encoder.bytes(text(field));
+    }
+}
+
+std::size_t unit::TxPayload::encoded_size() const {
+    std::size_t size = 1 + 4;
+    for (Field field : PAYLOAD_FIELDS)
+        if (has(field))
+            size += 4 + std::char_traits<char>::length(key_of(field)) + 1 + 4 + text(field).size();
+    return size;
+}
+
+// Reads what Encoder::json() wrote for the extradata, without building the JSON value. Extradata of older
+// transactions that is not an object of strings (genesis ones carried a plain string) leaves fields out.
+unit::TxPayload unit::TxPayload::decode(Decoder &decoder) {
+    TxPayload payload;
+    if (decoder.peek() != TAG_OBJECT) {
+        decoder.json();
+        return payload;
+    }
+    decoder.u8();
+    uint32_t count = decoder.u32();
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string key = decoder.bytes();
+        std::optional<Field> field = field_of(key);
+        if (!field.has_value() || decoder.peek() != TAG_STRING) {
+            decoder.json();
+            continue;
+        }
+        decoder.u8();
+        payload.set(field.value(), decoder.bytes());
+    }
+    return payload;
+}
+
+bool unit::TxPayload::operator==(const TxPayload &rhs) const {
+    return this->fields == rhs.fields && this->bytecode_ == rhs.bytecode_ && this->name_ == rhs.name_ && this->value_ == rhs.value_;
+}
+
+std::optional<unit::TxPayload::Field> unit::TxPayload::field_of(std::string_view key) {
+    for (Field field : PAYLOAD_FIELDS)
+        if (key == key_of(field))
+            return field;
+    return std::nullopt;
+}
+
+const char *unit::TxPayload::key_of(Field field) {
+    switch (field) {
+        case BYTECODE:
+            return "bytecode";
+        case NAME:
+            return "name";
+        default:
+            return "value";
+    }
+}
+
+const std::string &unit::TxPayload::text(Field field) const {
+    switch (field) {
+        case BYTECODE:
+            return this->bytecode_;
+        case NAME:
+            return this->name_;
+        default:
+            return this->value_;
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef UVM_TXPAYLOAD_H
+#define UVM_TXPAYLOAD_H
+#include "cstdint"
+#include "optional"
+#include "string"
+#include "boost/json.hpp"
+#include "Codec/Codec.h"
+
+namespace unit {
+    // Extradata of a transaction, parsed once when the transaction enters the node instead of being looked up
+    // in a JSON tree at every stage. Only the fields transaction types use are kept, names and values of usual
+    // length fit std::string's inline buffer. Encodes to exactly what Encoder::json() writes for the same
+    // JSON object, so transaction hashes are the same as with the JSON extradata.
+    class TxPayload {
+    public:
+        enum Field : uint8_t { // in the order of their keys
+            BYTECODE = 1,
+            NAME = 2,
+            VALUE = 4,
+        };
+
+        // string fields of an object, anything else is ignored
+        static TxPayload from_json(const boost::json::value &extra);
+        [[nodiscard]] boost::json::object to_json() const;
+
+        void set(Field field, std::string text);
+        [[nodiscard]] bool has(Field field) const { return (fields & field) != 0; }
+
+        [[nodiscard]] const std::string &bytecode() const { return bytecode_; } // hex encoded token definition, CREATE_TOKEN
+        [[nodiscard]] const std::string &name() const { return name_; }         // token name, TOKEN_TRANSFER
+        [[nodiscard]] const std::string &value() const { return value_; }       // token amount as sent, TOKEN_TRANSFER
+        [[nodiscard]] std::optional<double> token_amount() const { return token_amount_; } // value, when it is a number
+
+        void encode(Encoder &encoder) const;
+        [[nodiscard]] std::size_t encoded_size() const;
+        static TxPayload decode(Decoder &decoder);
+
+        bool operator==(const TxPayload &rhs) const;
+        bool operator!=(const TxPayload &rhs) const { return !(*this == rhs); }
+
+    private:
+        uint8_t fields = 0;
+        std::string bytecode_;
+        std::string name_;
+        std::string value_;
+        std::optional<double> token_amount_;
+
+        static std::optional<Field> field_of(std::string_view key);
+        static const char *key_of(Field field);
+        [[nodiscard]] const std::string &text(Field field) const;
+    };
+}
+
+#endif //UVM_TXPAYLOAD_H
@@ -51,7 +51,7 @@ std::ostream &operator<<(std::ostream &out, const WalletAccount &walletAccount)
     std::string inputs = serialize(boost::json::value_from(walletAccount.inputs));
     std::string outputs = serialize((boost::json::value_from(walletAccount.outputs)));
 
-    return out << R"({"address":")" << walletAccount.address <<  R"(", "amount":)" << walletAccount.amount <<  R"(, "tokens_balance":[)" << serialized_token_balances << R"(], "inputs": )" << inputs << R"(, "outputs": )" << outputs << "}";
+    return out << R"({"address":")" << walletAccount.address <<  R"(", "amount":)" << walletAccount.amount <<  R"(, "tokens_balance":[)" << serialized_token_balances << R"(], "inputs": )" << inputs << R"(, "outputs": )" << outputs << R"(, "nonce":)" << walletAccount.nonce << "}";
 }
 
 
@@ -113,6 +113,12 @@ bool WalletAccount::isEnoughUnitBalance(const boost::json::value& balance, doubl
     return true;
 }
 
+uint64_t WalletAccount::getNonce(const boost::json::value& balance) {
+    if (!balance.as_object().contains("nonce"))
+        return 0;
+    return boost::json::value_to<uint64_t>(balance.at("nonce"));
+}
+
 //void WalletAccount::serialize_from_json(std::string &account) {
 //
 //}
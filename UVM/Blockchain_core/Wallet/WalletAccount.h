@@ -23,6 +23,7 @@ public:
     std::map<std::string, std::string> non_default_balances;
     std::vector<std::string> inputs;
     std::vector<std::string> outputs;
+    uint64_t nonce = 0; // next nonce expected from this address
 
     // getters & setters
     [[nodiscard]] const std::string &getAddress() const;
@@ -42,6 +43,7 @@ public:
     void serialize_from_json(std::string &account);
     static bool isEnoughTokenBalance(const boost::json::value& balance, const std::string& token_name, double value);
     static bool isEnoughUnitBalance(const boost::json::value& balance, double value);
+    static uint64_t getNonce(const boost::json::value& balance); // accounts created before nonces start at 0
 //    static nlohmann::json subtract_unit_balance(nlohmann::json &account, double value);
 //    static nlohmann::json increase_unit_balance(nlohmann::json &account, double value);
 };
@@ -5,6 +5,9 @@
 #ifndef UVM_ENV_H
 #define UVM_ENV_H
 #include "iostream"
+#include "cstdint"
+#include "cstdlib"
+#include "string"
 //#if defined(OS_WIN)
 //#include <Windows.h>
 //    std::string kDBPath = "C:\\Windows\\TEMP\\unit";
@@ -19,4 +22,34 @@
 //const char DBPath[] = "/home/unit";
 //const int cpus = (int) std::thread::hardware_concurrency();
 //#endif
+
+namespace unit {
+    // node settings are taken from environment variables (UNIT_*), falling back to compiled defaults
+    inline uint64_t env_u64(const char *name, uint64_t default_value) {
+        const char *value = std::getenv(name);
+        if (value == nullptr || *value == '\0')
+            return default_value;
+        try {
+            return std::stoull(value);
+        } catch (std::exception &e) {
+            std::cerr << "Invalid value of " << name << ": " << value << ", using " << default_value << std::endl;
+            return default_value;
+        }
+    }
+
+    inline bool env_bool(const char *name, bool default_value) {
+        const char *value = std::getenv(name);
+        if (value == nullptr || *value == '\0')
+            return default_value;
+        std::string str = value;
+        return str == "1" || str == "true" || str == "on";
+    }
+
+    inline std::string env_string(const char *name, const std::string &default_value) {
+        const char *value = std::getenv(name);
+        if (value == nullptr || *value == '\0')
+            return default_value;
+        return value;
+    }
+}
 #endif //UVM_ENV_H
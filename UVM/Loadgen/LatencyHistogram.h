@@ -0,0 +1,95 @@
+#ifndef UVM_LATENCYHISTOGRAM_H
+#define UVM_LATENCYHISTOGRAM_H
+#include "algorithm"
+#include "cstdint"
+#include "vector"
+
+#define HISTOGRAM_SUB_BUCKET_BITS 7 // 64 linear buckets per power of two, values are kept within 1/64 (< 1.6%)
+#define HISTOGRAM_MAX_MAGNITUDE 40  // values up to 2^40 us (~12 days), larger ones are clamped
+
+// HDR-style histogram of latencies in microseconds: exact below 128 us, then every power of two is split
+// into 64 equal buckets, so memory is fixed (a few KB) and the relative error of any percentile is bounded.
+// Not thread-safe, every client records into its own histogram and they are merged at the end.
+class LatencyHistogram {
+public:
+    LatencyHistogram() : counts(bucket_count(), 0) {}
+
+    void record(uint64_t micros) {
+        ++counts[index_of(std::min(micros, max_trackable()))];
+        ++total;
+        max_value = std::max(max_value, micros);
+        min_value = std::min(min_value, micros);
+        sum += micros;
+    }
+
+    void merge(const LatencyHistogram &other) {
+        for (std::size_t i = 0; i < counts.size(); ++i)
+            counts[i] += other.counts[i];
+        total += other.total;
+        max_value = std::max(max_value, other.max_value);
+        min_value = std::min(min_value, other.min_value);
+        sum += other.sum;
+    }
+
+    [[nodiscard]] uint64_t count() const { return total; }
+    [[nodiscard]] uint64_t max() const { return max_value; }
+    [[nodiscard]] uint64_t min() const { return total == 0 ? 0 : min_value; }
+    [[nodiscard]] double mean() const { return total == 0 ? 0 : static_cast<double>(sum) / static_cast<double>(total); }
+
+    // highest value equivalent to the one at the percentile (0..100], 0 while empty
+    [[nodiscard]] uint64_t percentile(double percent) const {
+        if (total == 0)
+            return 0;
+        auto rank = static_cast<uint64_t>(static_cast<double>(total) * percent / 100.0 + 0.5);
+        rank = std::max<uint64_t>(1, std::min(rank, total));
+        uint64_t seen = 0;
+        for (std::size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if (seen >= rank)
+                return std::min(highest_of(i), max_value);
+        }
+        return max_value;
+    }
+
+private:
+    static constexpr uint64_t SUB_BUCKETS = uint64_t(1) << HISTOGRAM_SUB_BUCKET_BITS;
+    static constexpr uint64_t HALF = SUB_BUCKETS / 2;
+
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t max_value = 0;
+    uint64_t min_value = UINT64_MAX;
+    uint64_t sum = 0;
+
+    static constexpr uint64_t max_trackable() { return (uint64_t(1) << HISTOGRAM_MAX_MAGNITUDE) - 1; }
+
+    static constexpr std::size_t bucket_count() {
+        return SUB_BUCKETS + (HISTOGRAM_MAX_MAGNITUDE - HISTOGRAM_SUB_BUCKET_BITS) * HALF;
+    }
+
+    static unsigned magnitude(uint64_t value) {
+        unsigned bits = 0;
+        while (value >>= 1)
+            ++bits;
+        return bits;
+    }
+
+    // values below SUB_BUCKETS have a bucket each, above that the top HISTOGRAM_SUB_BUCKET_BITS bits pick it
+    static std::size_t index_of(uint64_t value) {
+        if (value < SUB_BUCKETS)
+            return value;
+        unsigned shift = magnitude(value) - (HISTOGRAM_SUB_BUCKET_BITS - 1);
+        uint64_t sub = value >> shift; // in [HALF, SUB_BUCKETS)
+        return SUB_BUCKETS + (shift - 1) * HALF + (sub - HALF);
+    }
+
+    static uint64_t highest_of(std::size_t index) {
+        if (index < SUB_BUCKETS)
+            return index;
+        uint64_t shift = (index - SUB_BUCKETS) / HALF + 1;
+        uint64_t sub = (index - SUB_BUCKETS) % HALF + HALF;
+        return ((sub + 1) << shift) - 1;
+    }
+};
+
+#endif //UVM_LATENCYHISTOGRAM_H
@@ -0,0 +1,645 @@
+// Load generator for the HTTP API: keeps many keep-alive connections busy with a weighted mix of
+// instructions and reports throughput, latency percentiles and errors per instruction.
+// Every connection sends its next request as soon as the previous one is answered (closed loop), so the
+// latencies are the ones a client sees at the throughput reached, not at a fixed offered rate.
+
+#include "algorithm"
+#include "atomic"
+#include "chrono"
+#include "cmath"
+#include "cstdio"
+#include "fstream"
+#include "iostream"
+#include "memory"
+#include "mutex"
+#include "optional"
+#include "random"
+#include "string"
+#include "thread"
+#include "vector"
+#include "boost/asio.hpp"
+#include "boost/beast/core.hpp"
+#include "boost/beast/http.hpp"
+#include "boost/json/src.hpp"
+#include "LatencyHistogram.h"
+
+#define LOADGEN_DEFAULT_HOST "127.0.0.1"
+#define LOADGEN_DEFAULT_PORT 29000
+#define LOADGEN_DEFAULT_CONNECTIONS 16 // with the default mix about 3 push at a time, one per default sender
+#define LOADGEN_DEFAULT_DURATION_S 30
+#define LOADGEN_DEFAULT_WARMUP_S 2
+#define LOADGEN_DEFAULT_MIX "i_balance=40,i_tx=20,i_push_transaction=20,i_block_height=20"
+#define LOADGEN_DEFAULT_ACCOUNTS "g2px1,teo,sunaked,merchant" // funded by the genesis block
+#define LOADGEN_DEFAULT_AMOUNT "0.00001"
+#define LOADGEN_HASH_RING 4096 // hashes of accepted transactions kept for i_tx
+#define LOADGEN_RECONNECT_DELAY_MS 100
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+using tcp = boost::asio::ip::tcp;
+
+enum Instruction {
+    I_BALANCE,
+    I_TX,
+    I_PUSH_TRANSACTION,
+    I_BLOCK_HEIGHT,
+    INSTRUCTION_COUNT
+};
+
+static const char *INSTRUCTION_NAMES[INSTRUCTION_COUNT] = {"i_balance", "i_tx", "i_push_transaction", "i_block_height"};
+
+enum Failure {
+    FAILURE_4XX,         // rejected request, e.g. a lookup miss or a rejected transaction
+    FAILURE_RATE_LIMITED, // 429 from admission control
+    FAILURE_UNAVAILABLE,  // 503, the node is overloaded or a request timed out
+    FAILURE_5XX,
+    FAILURE_IO,           // connect, write or read failed
+    FAILURE_COUNT
+};
+
+static const char *FAILURE_NAMES[FAILURE_COUNT] = {"4xx", "429", "503", "5xx", "io"};
+
+struct Options {
+    std::string host = LOADGEN_DEFAULT_HOST;
+    uint16_t port = LOADGEN_DEFAULT_PORT;
+    std::size_t connections = LOADGEN_DEFAULT_CONNECTIONS;
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t duration_s = LOADGEN_DEFAULT_DURATION_S;
+    uint64_t warmup_s = LOADGEN_DEFAULT_WARMUP_S;
+    uint64_t seed = 1;
+    std::string mix = LOADGEN_DEFAULT_MIX;
+    std::string accounts = LOADGEN_DEFAULT_ACCOUNTS;
+    std::string amount = LOADGEN_DEFAULT_AMOUNT;
+    std::string tx_hashes; // file with one hash per line
+};
+
+// counters of one client, merged once the run is over
+struct Stats {
+    LatencyHistogram latency[INSTRUCTION_COUNT];
+    uint64_t failures[INSTRUCTION_COUNT][FAILURE_COUNT] = {};
+    uint64_t pushes_downgraded = 0; // every sender was busy, sent and counted as i_balance
+
+    void merge(const Stats &other) {
+        pushes_downgraded += other.pushes_downgraded;
+        for (int i = 0; i < INSTRUCTION_COUNT; ++i) {
+            latency[i].merge(other.latency[i]);
+            for (int f = 0; f < FAILURE_COUNT; ++f)
+                failures[i][f] += other.failures[i][f];
+        }
+    }
+
+    [[nodiscard]] uint64_t failed(int instruction) const {
+        uint64_t count = 0;
+        for (uint64_t value : failures[instruction])
+            count += value;
+        return count;
+    }
+};
+
+// A sender is used by one connection at a time, which keeps its nonce until the push is answered: the nonce
+// only advances when the node accepted the transaction, after a failed or rejected push it is read again.
+struct Sender {
+    std::atomic<bool> claimed{false};
+    uint64_t nonce = 0; // next nonce, touched by the claiming connection only
+    bool stale = false; // the node may count differently, i_nonce is asked before the next push
+};
+
+// state every client reads: senders with their next nonces and hashes known to exist
+struct Workload {
+    std::vector<double> weights; // per instruction
+    std::vector<std::string> accounts;
+    std::unique_ptr<Sender[]> senders;
+    std::string amount;
+
+    std::mutex hashes_mutex;
+    std::vector<std::string> hashes;
+    std::size_t next_hash = 0;
+
+    std::atomic<bool> recording{false};
+    std::atomic<bool> stopping{false};
+
+    void remember_hash(std::string hash) {
+        std::lock_guard<std::mutex> lock(hashes_mutex);
+        if (hashes.size() < LOADGEN_HASH_RING) {
+            hashes.push_back(std::move(hash));
+            return;
+        }
+        hashes[next_hash] = std::move(hash);
+        next_hash = (next_hash + 1) % LOADGEN_HASH_RING;
+    }
+
+    // an all-zero hash while none is known, which the node answers as not found
+    std::string pick_hash(std::mt19937_64 &random) {
+        std::lock_guard<std::mutex> lock(hashes_mutex);
+        if (hashes.empty())
+            return "0x" + std::string(64, '0');
+        return hashes[random() % hashes.size()];
+    }
+
+    // the first free sender from start on, accounts.size() when every one is busy
+    std::size_t claim_sender(std::size_t start) {
+        for (std::size_t i = 0; i < accounts.size(); ++i) {
+            std::size_t account = (start + i) % accounts.size();
+            if (!senders[account].claimed.exchange(true, std::memory_order_acquire))
+                return account;
+        }
+        return accounts.size();
+    }
+
+    void release_sender(std::size_t account) {
+        senders[account].claimed.store(false, std::memory_order_release);
+    }
+};
+
+std::string nonce_request(const std::string &account) {
+    return R"({"instruction":"i_nonce","data":{"name":")" + account + R"("}})";
+}
+
+// next nonce of an i_nonce answer, pending transactions included
+std::optional<uint64_t> nonce_of(const http::response<http::string_body> &response) {
+    if (response.result() != http::status::ok)
+        return std::nullopt;
+    boost::json::error_code ec;
+    boost::json::value json = boost::json::parse(response.body(), ec);
+    const boost::json::value *nonce = ec || !json.is_object() ? nullptr : json.as_object().if_contains("nonce");
+    if (nonce == nullptr || !nonce->is_number())
+        return std::nullopt;
+    return boost::json::value_to<uint64_t>(*nonce);
+}
+
+std::vector<std::string> split(const std::string &value, char separator) {
+    std::vector<std::string> parts;
+    std::size_t start = 0;
+    while (start <= value.size()) {
+        std::size_t end = value.find(separator, start);
+        if (end == std::string::npos)
+            end = value.size();
+        if (end > start)
+            parts.push_back(value.substr(start, end - start));
+        start = end + 1;
+    }
+    return parts;
+}
+
+// "i_balance=40,i_tx=20" -> weights per instruction, false when an entry is malformed
+bool parse_mix(const std::string &mix, std::vector<double> &weights) {
+    weights.assign(INSTRUCTION_COUNT, 0);
+    for (const std::string &entry : split(mix, ',')) {
+        std::size_t equals = entry.find('=');
+        if (equals == std::string::npos)
+            return false;
+        std::string name = entry.substr(0, equals);
+        auto found = std::find_if(std::begin(INSTRUCTION_NAMES), std::end(INSTRUCTION_NAMES), [&name](const char *known) { return name == known; });
+        if (found == std::end(INSTRUCTION_NAMES))
+            return false;
+        try {
+            weights[found - std::begin(INSTRUCTION_NAMES)] = std::stod(entry.substr(equals + 1));
+        } catch (std::exception &e) {
+            return false;
+        }
+    }
+    for (double weight : weights)
+        if (weight < 0)
+            return false;
+    return std::any_of(weights.begin(), weights.end(), [](double weight) { return weight > 0; });
+}
+
+void usage() {
+    std::cout << "Usage: unit_loadgen [options]\n"
+                 "  --host <address>        node address (" LOADGEN_DEFAULT_HOST ")\n"
+                 "  --port <port>           HTTP port (" << LOADGEN_DEFAULT_PORT << ")\n"
+                 "  --connections <n>       concurrent keep-alive connections (" << LOADGEN_DEFAULT_CONNECTIONS << ")\n"
+                 "  --threads <n>           I/O threads (number of cores)\n"
+                 "  --duration <s>          measured seconds (" << LOADGEN_DEFAULT_DURATION_S << ")\n"
+                 "  --warmup <s>            seconds before measuring starts (" << LOADGEN_DEFAULT_WARMUP_S << ")\n"
+                 "  --mix <name=weight,...> instruction mix (" LOADGEN_DEFAULT_MIX ")\n"
+                 "  --accounts <a,b,...>    funded addresses used by i_balance and as senders (" LOADGEN_DEFAULT_ACCOUNTS ")\n"
+                 "  --amount <units>        amount of every pushed transfer (" LOADGEN_DEFAULT_AMOUNT ")\n"
+                 "  --tx-hashes <file>      transaction hashes for i_tx, one per line (hashes of accepted pushes otherwise)\n"
+                 "  --seed <n>              seed of the request sequence (1)\n";
+}
+
+bool parse_options(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string name = argv[i];
+        if (name == "--help" || name == "-h")
+            return false;
+        if (i + 1 == argc) {
+            std::cout << "Error: " << name << " needs a value" << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        try {
+            if (name == "--host") options.host = value;
+            else if (name == "--port") options.port = static_cast<uint16_t>(std::stoul(value));
+            else if (name == "--connections") options.connections = std::stoul(value);
+            else if (name == "--threads") options.threads = std::stoul(value);
+            else if (name == "--duration") options.duration_s = std::stoull(value);
+            else if (name == "--warmup") options.warmup_s = std::stoull(value);
+            else if (name == "--mix") options.mix = value;
+            else if (name == "--accounts") options.accounts = value;
+            else if (name == "--amount") options.amount = value;
+            else if (name == "--tx-hashes") options.tx_hashes = value;
+            else if (name == "--seed") options.seed = std::stoull(value);
+            else {
+                std::cout << "Error: unknown option " << name << std::endl;
+                return false;
+            }
+        } catch (std::exception &e) {
+            std::cout << "Error: invalid value of " << name << ": " << value << std::endl;
+            return false;
+        }
+    }
+    if (options.connections == 0 || options.threads == 0 || options.duration_s == 0) {
+        std::cout << "Error: connections, threads and duration must be positive" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// one keep-alive connection sending requests back to back on its own strand
+class client {
+public:
+    client(net::io_context &ioc, const tcp::resolver::results_type &endpoints, Workload &workload, uint64_t seed)
+            : stream_(net::make_strand(ioc)), retry_timer_(stream_.get_executor()), endpoints_(endpoints),
+              workload_(workload), random_(seed), pick_(workload.weights.begin(), workload.weights.end()),
+              sender_(workload.accounts.size())
+    {
+    }
+
+    void start()
+    {
+        net::dispatch(stream_.get_executor(), [this]() { connect(); });
+    }
+
+    // called on the client's strand once the run is over
+    void stop()
+    {
+        net::dispatch(stream_.get_executor(), [this]()
+        {
+            beast::error_code ec;
+            retry_timer_.cancel();
+            stream_.socket().shutdown(tcp::socket::shutdown_both, ec);
+            stream_.close();
+        });
+    }
+
+    [[nodiscard]] const Stats &stats() const { return stats_; }
+
+private:
+    beast::tcp_stream stream_;
+    net::steady_timer retry_timer_;
+    const tcp::resolver::results_type &endpoints_;
+    Workload &workload_;
+    std::mt19937_64 random_;
+    std::discrete_distribution<int> pick_;
+
+    beast::flat_buffer buffer_;
+    http::request<http::string_body> request_;
+    http::response<http::string_body> response_;
+    Instruction instruction_ = I_BALANCE;
+    std::size_t sender_; // claimed sender of the push in flight, accounts.size() when none
+    bool resync_ = false; // the request in flight is the sender's i_nonce, not counted
+    std::chrono::steady_clock::time_point sent_;
+    Stats stats_;
+
+    void connect()
+    {
+        if (workload_.stopping.load(std::memory_order_relaxed))
+            return;
+        stream_.async_connect(endpoints_, [this](beast::error_code ec, const tcp::endpoint &)
+        {
+            if (ec)
+                return failed(false);
+            send_next();
+        });
+    }
+
+    void send_next()
+    {
+        if (workload_.stopping.load(std::memory_order_relaxed))
+            return;
+        instruction_ = static_cast<Instruction>(pick_(random_));
+        request_ = {http::verb::post, "/", 11};
+        request_.set(http::field::host, "unit");
+        request_.set(http::field::content_type, "application/json");
+        request_.keep_alive(true);
+        request_.body() = body_of(instruction_);
+        request_.prepare_payload();
+
+        sent_ = std::chrono::steady_clock::now();
+        http::async_write(stream_, request_, [this](beast::error_code ec, std::size_t)
+        {
+            if (ec)
+                return failed(true);
+            response_ = {};
+            http::async_read(stream_, buffer_, response_, [this](beast::error_code ec, std::size_t)
+            {
+                if (ec)
+                    return failed(true);
+                answered();
+            });
+        });
+    }
+
+    void answered()
+    {
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - sent_).count();
+        unsigned status = response_.result_int();
+        if (resync_)
+            resynced();
+        else if (workload_.recording.load(std::memory_order_relaxed))
+        {
+            stats_.latency[instruction_].record(static_cast<uint64_t>(micros));
+            if (status == 429)
+                ++stats_.failures[instruction_][FAILURE_RATE_LIMITED];
+            else if (status == 503)
+                ++stats_.failures[instruction_][FAILURE_UNAVAILABLE];
+            else if (status >= 500)
+                ++stats_.failures[instruction_][FAILURE_5XX];
+            else if (status >= 400)
+                ++stats_.failures[instruction_][FAILURE_4XX];
+        }
+        if (!resync_ && instruction_ == I_PUSH_TRANSACTION)
+            pushed(status);
+        resync_ = false;
+
+        if (!response_.keep_alive())
+        {
+            beast::error_code ec;
+            stream_.socket().shutdown(tcp::socket::shutdown_both, ec);
+            stream_.close();
+            return connect();
+        }
+        send_next();
+    }
+
+    // the connection is dropped and opened again after a pause, so a node that is down is not hammered
+    void failed(bool in_flight)
+    {
+        if (workload_.stopping.load(std::memory_order_relaxed))
+            return;
+        if (workload_.recording.load(std::memory_order_relaxed) && !resync_)
+            ++stats_.failures[in_flight ? instruction_ : I_BALANCE][FAILURE_IO]; // failed connects are counted once, under the first instruction
+        if (in_flight && sender_ != workload_.accounts.size())
+        {
+            workload_.senders[sender_].stale = true; // the transaction may have arrived
+            workload_.release_sender(sender_);
+            sender_ = workload_.accounts.size();
+        }
+        resync_ = false;
+        stream_.close();
+        retry_timer_.expires_after(std::chrono::milliseconds(LOADGEN_RECONNECT_DELAY_MS));
+        retry_timer_.async_wait([this](beast::error_code ec)
+        {
+            if (!ec)
+                connect();
+        });
+    }
+
+    // the push is answered: its nonce is used up only when the transaction was accepted
+    void pushed(unsigned status)
+    {
+        Sender &sender = workload_.senders[sender_];
+        if (status == 200)
+        {
+            ++sender.nonce;
+            remember_hash();
+        }
+        else if (status != 429 && status != 503)
+            sender.stale = true; // rejected, possibly for its nonce
+        workload_.release_sender(sender_);
+        sender_ = workload_.accounts.size();
+    }
+
+    void resynced()
+    {
+        Sender &sender = workload_.senders[sender_];
+        std::optional<uint64_t> nonce = nonce_of(response_);
+        if (nonce.has_value())
+        {
+            sender.nonce = nonce.value();
+            sender.stale = false;
+        }
+        workload_.release_sender(sender_);
+        sender_ = workload_.accounts.size();
+    }
+
+    void remember_hash()
+    {
+        boost::json::error_code ec;
+        boost::json::value json = boost::json::parse(response_.body(), ec);
+        if (ec || !json.is_object())
+            return;
+        const boost::json::value *hash = json.as_object().if_contains("hash");
+        if (hash != nullptr && hash->is_string())
+            workload_.remember_hash(std::string(hash->as_string()));
+    }
+
+    std::string body_of(Instruction instruction)
+    {
+        const std::vector<std::string> &accounts = workload_.accounts;
+        std::size_t account = random_() % accounts.size();
+        switch (instruction)
+        {
+            case I_BALANCE:
+                return R"({"instruction":"i_balance","data":{"name":")" + accounts[account] + R"("}})";
+            case I_TX:
+                return R"({"instruction":"i_tx","data":{"hash":")" + workload_.pick_hash(random_) + R"("}})";
+            case I_PUSH_TRANSACTION:
+            {
+                sender_ = workload_.claim_sender(account);
+                if (sender_ == accounts.size()) // more connections push than there are senders
+                {
+                    if (workload_.recording.load(std::memory_order_relaxed))
+                        ++stats_.pushes_downgraded;
+                    instruction_ = I_BALANCE;
+                    return R"({"instruction":"i_balance","data":{"name":")" + accounts[account] + R"("}})";
+                }
+                const Sender &sender = workload_.senders[sender_];
+                if (sender.stale)
+                {
+                    resync_ = true;
+                    return nonce_request(accounts[sender_]);
+                }
+                const std::string &to = accounts[(sender_ + 1) % accounts.size()];
+                return R"({"instruction":"i_push_transaction","data":{"from":")" + accounts[sender_] + R"(","to":")" + to +
+                       R"(","amount":)" + workload_.amount + R"(,"type":0,"nonce":)" + std::to_string(sender.nonce) +
+                       R"(,"extradata":{"name":"null","value":"null","bytecode":"null"}}})";
+            }
+            case I_BLOCK_HEIGHT:
+            default:
+                return R"({"instruction":"i_block_height"})";
+        }
+    }
+};
+
+// next nonce of every sender as the node counts it, pending transactions included
+bool fetch_nonces(net::io_context &ioc, const tcp::resolver::results_type &endpoints, Workload &workload) {
+    workload.senders.reset(new Sender[workload.accounts.size()]);
+    try {
+        beast::tcp_stream stream(ioc);
+        stream.connect(endpoints);
+        beast::flat_buffer buffer;
+        for (std::size_t i = 0; i < workload.accounts.size(); ++i) {
+            http::request<http::string_body> request{http::verb::post, "/", 11};
+            request.set(http::field::host, "unit");
+            request.set(http::field::content_type, "application/json");
+            request.keep_alive(true);
+            request.body() = nonce_request(workload.accounts[i]);
+            request.prepare_payload();
+            http::write(stream, request);
+            http::response<http::string_body> response;
+            http::read(stream, buffer, response);
+
+            std::optional<uint64_t> nonce = nonce_of(response);
+            if (!nonce.has_value()) {
+                std::cout << "Error: no nonce for " << workload.accounts[i] << ": " << response.body() << std::endl;
+                return false;
+            }
+            workload.senders[i].nonce = nonce.value();
+            if (!response.keep_alive()) {
+                stream.close();
+                stream.connect(endpoints);
+            }
+        }
+        beast::error_code ec;
+        stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+    } catch (std::exception &e) {
+        std::cout << "Error: could not reach the node: " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool load_hashes(const std::string &path, Workload &workload) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cout << "Error: could not open " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line))
+        if (!line.empty())
+            workload.remember_hash(line);
+    return true;
+}
+
+void print_report(const Options &options, const Stats &total) {
+    auto ms = [](uint64_t micros) { return static_cast<double>(micros) / 1000.0; };
+    double seconds = static_cast<double>(options.duration_s);
+
+    std::printf("%-20s %10s %10s %8s %9s %9s %9s %9s %9s %9s\n", "instruction", "requests", "req/s", "errors", "mean ms", "p50 ms", "p90 ms", "p99 ms", "p99.9 ms", "max ms");
+    LatencyHistogram all;
+    uint64_t all_requests = 0;
+    uint64_t all_failed = 0;
+    for (int i = 0; i < INSTRUCTION_COUNT; ++i) {
+        const LatencyHistogram &latency = total.latency[i];
+        uint64_t requests = latency.count() + total.failures[i][FAILURE_IO]; // requests lost to I/O errors have no latency
+        all.merge(latency);
+        all_requests += requests;
+        all_failed += total.failed(i);
+        if (requests == 0)
+            continue;
+        double error_rate = 100.0 * static_cast<double>(total.failed(i)) / static_cast<double>(requests);
+        std::printf("%-20s %10llu %10.1f %7.2f%% %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n", INSTRUCTION_NAMES[i],
+                    static_cast<unsigned long long>(requests), static_cast<double>(latency.count()) / seconds, error_rate,
+                    latency.mean() / 1000.0, ms(latency.percentile(50)), ms(latency.percentile(90)), ms(latency.percentile(99)),
+                    ms(latency.percentile(99.9)), ms(latency.max()));
+    }
+    double error_rate = all_requests == 0 ? 0.0 : 100.0 * static_cast<double>(all_failed) / static_cast<double>(all_requests);
+    std::printf("%-20s %10llu %10.1f %7.2f%% %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n", "total",
+                static_cast<unsigned long long>(all_requests), static_cast<double>(all.count()) / seconds, error_rate,
+                all.mean() / 1000.0, ms(all.percentile(50)), ms(all.percentile(90)), ms(all.percentile(99)),
+                ms(all.percentile(99.9)), ms(all.max()));
+
+    std::printf("\nerrors by kind:\n");
+    for (int i = 0; i < INSTRUCTION_COUNT; ++i) {
+        if (total.failed(i) == 0)
+            continue;
+        std::printf("  %-20s", INSTRUCTION_NAMES[i]);
+        for (int f = 0; f < FAILURE_COUNT; ++f)
+            std::printf(" %s: %llu", FAILURE_NAMES[f], static_cast<unsigned long long>(total.failures[i][f]));
+        std::printf("\n");
+    }
+    if (all_failed == 0)
+        std::printf("  none\n");
+
+    if (total.pushes_downgraded > 0)
+        std::printf("\n%llu i_push_transaction found every sender busy and went out as i_balance, counted there;"
+                    " use more --accounts or fewer --connections\n", static_cast<unsigned long long>(total.pushes_downgraded));
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        usage();
+        return 1;
+    }
+    Workload workload;
+    workload.accounts = split(options.accounts, ',');
+    workload.amount = options.amount;
+    if (!parse_mix(options.mix, workload.weights)) {
+        std::cout << "Error: invalid mix " << options.mix << std::endl;
+        return 1;
+    }
+    if (workload.accounts.empty()) {
+        std::cout << "Error: no accounts" << std::endl;
+        return 1;
+    }
+    if (!options.tx_hashes.empty() && !load_hashes(options.tx_hashes, workload))
+        return 1;
+
+    net::io_context ioc;
+    tcp::resolver::results_type endpoints;
+    try {
+        endpoints = tcp::resolver(ioc).resolve(options.host, std::to_string(options.port));
+    } catch (std::exception &e) {
+        std::cout << "Error: could not resolve " << options.host << ": " << e.what() << std::endl;
+        return 1;
+    }
+    if (!fetch_nonces(ioc, endpoints, workload))
+        return 1;
+
+    // a sender pushes on one connection at a time, pushes beyond the number of senders are sent as i_balance
+    double weights = 0;
+    for (double weight : workload.weights)
+        weights += weight;
+    double pushing = static_cast<double>(options.connections) * workload.weights[I_PUSH_TRANSACTION] / weights;
+    if (pushing > static_cast<double>(workload.accounts.size()))
+        std::cout << "Warning: about " << static_cast<uint64_t>(std::ceil(pushing)) << " connections push at a time but there are "
+                  << workload.accounts.size() << " senders, the other pushes are sent as i_balance; use more --accounts or fewer --connections" << std::endl;
+
+    std::cout << "unit_loadgen: " << options.host << ":" << options.port << ", " << options.connections << " connections, "
+              << options.threads << " threads, " << options.warmup_s << " s warm-up + " << options.duration_s << " s, seed "
+              << options.seed << std::endl;
+
+    std::vector<std::unique_ptr<client>> clients;
+    clients.reserve(options.connections);
+    for (std::size_t i = 0; i < options.connections; ++i) {
+        clients.emplace_back(new client(ioc, endpoints, workload, options.seed + i)); // every connection replays its own sequence
+        clients.back()->start();
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(options.threads);
+    for (std::size_t i = 0; i < options.threads; ++i)
+        threads.emplace_back([&ioc]() { ioc.run(); });
+
+    std::this_thread::sleep_for(std::chrono::seconds(options.warmup_s));
+    workload.recording.store(true);
+    std::this_thread::sleep_for(std::chrono::seconds(options.duration_s));
+    workload.recording.store(false);
+    workload.stopping.store(true);
+    for (std::unique_ptr<client> &c : clients)
+        c->stop();
+    for (std::thread &thread : threads)
+        thread.join();
+
+    Stats total;
+    for (const std::unique_ptr<client> &c : clients)
+        total.merge(c->stats());
+    print_report(options, total);
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include "AdmissionControl.h"
+#include "algorithm"
+#include "cmath"
+#include "functional"
+#include "sstream"
+#include "../ENV/env.h"
+#include "Server.h"
+
+AdmissionControl::AdmissionControl(const Mempool *mempool, const ValidationPipeline *pipeline)
+        : mempool(mempool), pipeline(pipeline),
+          rate(static_cast<double>(unit::env_u64("UNIT_ADMISSION_RATE_PER_CLIENT", ADMISSION_RATE_PER_CLIENT))),
+          local_rate(static_cast<double>(unit::env_u64("UNIT_ADMISSION_RATE_LOCAL", ADMISSION_RATE_LOCAL))),
+          burst(static_cast<double>(std::max<uint64_t>(unit::env_u64("UNIT_ADMISSION_BURST_PER_CLIENT", ADMISSION_BURST_PER_CLIENT), 1))),
+          max_in_flight(unit::env_u64("UNIT_ADMISSION_MAX_IN_FLIGHT", ADMISSION_MAX_IN_FLIGHT)),
+          mempool_high_watermark(unit::env_u64("UNIT_ADMISSION_MEMPOOL_HIGH_WATERMARK", ADMISSION_MEMPOOL_HIGH_WATERMARK)),
+          retry_after_s(unit::env_u64("UNIT_ADMISSION_RETRY_AFTER_S", ADMISSION_RETRY_AFTER_S)) {}
+
+AdmissionControl::Decision AdmissionControl::admit(const std::string &client, std::size_t transactions, uint64_t *retry_after_s) {
+    // cheapest checks first, a refused submission takes nothing from the client's bucket
+    double rate = is_local(client) ? this->local_rate : this->rate;
+    if (rate > 0 && static_cast<double>(transactions) > this->burst) {
+        this->rate_limited.fetch_add(1, std::memory_order_relaxed);
+        return TOO_LARGE;
+    }
+    if (this->mempool->bytes() * 100 >= this->mempool->max_size_bytes() * this->mempool_high_watermark
+        || this->pipeline->pending() * 100 >= this->pipeline->capacity() * this->mempool_high_watermark) {
+        this->saturated.fetch_add(1, std::memory_order_relaxed);
+        *retry_after_s = this->retry_after_s;
+        return SATURATED;
+    }
+
+    std::size_t current = this->in_flight.load(std::memory_order_relaxed);
+    do {
+        if (current + transactions > this->max_in_flight && current > 0) { // a batch bigger than the limit still gets in alone
+            this->overloaded.fetch_add(1, std::memory_order_relaxed);
+            *retry_after_s = 1;
+            return OVERLOADED;
+        }
+    } while (!this->in_flight.compare_exchange_weak(current, current + transactions, std::memory_order_relaxed));
+
+    if (!take_tokens(client, rate, transactions, retry_after_s)) {
+        release(transactions);
+        this->rate_limited.fetch_add(1, std::memory_order_relaxed);
+        return RATE_LIMITED;
+    }
+    this->admitted.fetch_add(1, std::memory_order_relaxed);
+    return ADMITTED;
+}
+
+void AdmissionControl::release(std::size_t transactions) {
+    this->in_flight.fetch_sub(transactions, std::memory_order_relaxed);
+}
+
+bool AdmissionControl::take_tokens(const std::string &client, double rate, std::size_t transactions, uint64_t *retry_after_s) {
+    if (rate <= 0)
+        return true;
+    Shard &shard = this->shards[std::hash<std::string>()(client) % ADMISSION_SHARDS];
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    if (shard.buckets.size() >= ADMISSION_MAX_CLIENTS / ADMISSION_SHARDS) {
+        // clients idle long enough to have a full bucket again lose nothing by being forgotten
+        std::chrono::duration<double> refill(this->burst / rate);
+        for (auto it = shard.buckets.begin(); it != shard.buckets.end();)
+            it = now - it->second.updated >= refill ? shard.buckets.erase(it) : std::next(it);
+    }
+
+    auto [found, created] = shard.buckets.try_emplace(client, Bucket{this->burst, now});
+    Bucket &bucket = found->second;
+    if (!created) {
+        double elapsed = std::chrono::duration<double>(now - bucket.updated).count();
+        bucket.tokens = std::min(this->burst, bucket.tokens + elapsed * rate);
+        bucket.updated = now;
+    }
+    auto needed = static_cast<double>(transactions); // never more than the burst, admit() refuses larger batches
+    if (bucket.tokens < needed) {
+        *retry_after_s = static_cast<uint64_t>(std::ceil((needed - bucket.tokens) / rate));
+        return false;
+    }
+    bucket.tokens -= needed;
+    return true;
+}
+
+bool AdmissionControl::is_local(const std::string &client) {
+    return client == HTTP_LOCAL_CLIENT || client == "::1" || client.rfind("127.", 0) == 0 || client.rfind("::ffff:127.", 0) == 0;
+}
+
+std::string AdmissionControl::stats_to_json_string() const {
+    std::ostringstream string_stream;
+    string_stream << R"({"in_flight":)" << this->in_flight << R"(, "admitted":)" << this->admitted << R"(, "rate_limited":)" << this->rate_limited
+                  << R"(, "overloaded":)" << this->overloaded << R"(, "saturated":)" << this->saturated << "}";
+    return string_stream.str();
+}
@@ -0,0 +1,85 @@
+#ifndef UVM_ADMISSIONCONTROL_H
+#define UVM_ADMISSIONCONTROL_H
+#include "atomic"
+#include "chrono"
+#include "cstdint"
+#include "mutex"
+#include "string"
+#include "unordered_map"
+#include "../Blockchain_core/Mempool/Mempool.h"
+#include "../Blockchain_core/Mempool/ValidationPipeline.h"
+
+#define ADMISSION_RATE_PER_CLIENT 0 // transactions per second and client address, 0 disables the limit
+#define ADMISSION_RATE_LOCAL 0 // the same for local clients (Unix socket and loopback), 0 exempts them
+#define ADMISSION_BURST_PER_CLIENT 400 // also the largest batch a rate limited client can submit
+#define ADMISSION_MAX_IN_FLIGHT 16384 // submitted transactions without a verdict yet
+#define ADMISSION_MEMPOOL_HIGH_WATERMARK 95 // percent of the mempool budget and of the pipeline's queues
+#define ADMISSION_RETRY_AFTER_S 5 // hint for saturated nodes, about a block interval
+#define ADMISSION_SHARDS 16
+#define ADMISSION_MAX_CLIENTS 65536 // tracked client buckets, idle ones are forgotten beyond that
+
+// Decides whether a submission is let into the validation pipeline, so that an overloaded node refuses work
+// early with a hint when to come back instead of queueing it:
+//   SATURATED    the mempool or the pipeline's queues are above the high watermark -> 503
+//   OVERLOADED   too many submitted transactions have no verdict yet -> 503
+//   RATE_LIMITED the client address spent its token bucket -> 429
+//   TOO_LARGE    the batch is bigger than the client's bucket can ever hold -> 400
+// Local clients have a rate of their own, by default they are not limited: all clients of the Unix socket
+// share one address (HTTP_LOCAL_CLIENT) and would otherwise share one bucket.
+// Transactions are the unit everywhere, a batch costs as much as its transactions.
+class AdmissionControl {
+public:
+    enum Decision {
+        ADMITTED = 0,
+        RATE_LIMITED = 1,
+        OVERLOADED = 2,
+        SATURATED = 3,
+        TOO_LARGE = 4,
+    };
+
+    AdmissionControl(const Mempool *mempool, const ValidationPipeline *pipeline);
+
+    // on ADMITTED the transactions count as in flight until release(), otherwise retry_after_s is set
+    Decision admit(const std::string &client, std::size_t transactions, uint64_t *retry_after_s);
+    // the submitted transactions got their verdicts (or were refused by the pipeline)
+    void release(std::size_t transactions);
+
+    [[nodiscard]] std::size_t max_batch() const { return static_cast<std::size_t>(this->burst); }
+    [[nodiscard]] std::string stats_to_json_string() const;
+
+private:
+    struct Bucket {
+        double tokens;
+        std::chrono::steady_clock::time_point updated;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<std::string, Bucket> buckets;
+    };
+
+    const Mempool *mempool;
+    const ValidationPipeline *pipeline;
+    const double rate;
+    const double local_rate;
+    const double burst;
+    const std::size_t max_in_flight;
+    const std::size_t mempool_high_watermark;
+    const uint64_t retry_after_s;
+    Shard shards[ADMISSION_SHARDS];
+
+    std::atomic<std::size_t> in_flight{0};
+    std::atomic<uint64_t> admitted{0};
+    std::atomic<uint64_t> rate_limited{0};
+    std::atomic<uint64_t> overloaded{0};
+    std::atomic<uint64_t> saturated{0};
+
+    // takes transactions from the client's bucket, false with the wait in retry_after_s when it is empty
+    bool take_tokens(const std::string &client, double rate, std::size_t transactions, uint64_t *retry_after_s);
+
+    // the Unix socket listener and loopback addresses
+    static bool is_local(const std::string &client);
+};
+
+
+#endif //UVM_ADMISSIONCONTROL_H
@@ -4,6 +4,7 @@
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/beast/version.hpp>
+#include <boost/beast/websocket.hpp>
 #include <boost/asio.hpp>
 #include <boost/json.hpp>
 #include <boost/algorithm/hex.hpp>
@@ -15,14 +16,29 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
+#include "algorithm"
+#include "atomic"
 #include "deque"
+#include "../ENV/env.h"
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "Server.h"
+#include "AdmissionControl.h"
+#include "StorageWorkers.h"
+#include "Subscriptions.h"
 
 namespace beast = boost::beast;   // from <boost/beast.hpp>
 namespace http = beast::http;     // from <boost/beast/http.hpp>
 namespace net = boost::asio;      // from <boost/asio.hpp>
 using tcp = boost::asio::ip::tcp; // from <boost/asio/ip/tcp.hpp>
+// TCP and Unix domain sockets are both moved into it, connections are served the same way whatever the listener
+using stream_socket = net::generic::stream_protocol::socket;
+namespace websocket = beast::websocket; // from <boost/beast/websocket.hpp>
 
 namespace my_program_state
 {
@@ -40,37 +56,409 @@ namespace my_program_state
     }
 }
 
+// WebSocket connection taken over from an HTTP upgrade request. The client sends subscriptions as JSON text
+// messages ({"subscribe":"newBlocks"}, {"subscribe":"txStatus","hash":"0x..."},
+// {"subscribe":"addressActivity","address":"..."}, {"unsubscribe":...} with the same fields) and receives their
+// events. A txStatus subscription ends with its status. Events are queued per session;
+// a session with more than the send queue limit of unsent messages is disconnected.
+class websocket_session : public Subscriptions::Subscriber, public std::enable_shared_from_this<websocket_session>
+{
+public:
+    websocket_session(stream_socket socket, Subscriptions *subscriptions, StorageWorkers *workers)
+            : ws_(std::move(socket)), subscriptions_(subscriptions), workers_(workers) {}
+
+    ~websocket_session() override
+    {
+        subscriptions_->unsubscribe(this, topics_);
+    }
+
+    // completes the handshake of the upgrade request, on the strand of the socket
+    void run(http::request<http::string_body> request)
+    {
+        ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+        ws_.set_option(websocket::stream_base::decorator([](websocket::response_type &response)
+        {
+            response.set(http::field::server, "Unit");
+        }));
+        ws_.read_message_max(WS_MAX_MESSAGE);
+        auto self = shared_from_this();
+        ws_.async_accept(request, [self](beast::error_code ec)
+        {
+            if (!ec)
+                self->read();
+        });
+    }
+
+    // from the commit thread: counted right away, queued on the session's strand
+    void deliver(const std::shared_ptr<const std::string> &message) override
+    {
+        auto self = shared_from_this();
+        enqueue([self, message]()
+        {
+            self->send(message);
+        });
+    }
+
+    // the commit and the lookup of check_committed may both report the transaction, the first one ends the
+    // subscription and is sent, the other finds it gone
+    void deliver_status(const unit::Hash32 &hash, const std::shared_ptr<const std::string> &message) override
+    {
+        auto self = shared_from_this();
+        enqueue([self, hash, message]()
+        {
+            if (forget(self->topics_.transactions, hash))
+            {
+                Subscriptions::Topics ended;
+                ended.transactions.push_back(hash);
+                self->subscriptions_->unsubscribe(self.get(), ended); // gone already when the commit reported it
+                self->send(message);
+            }
+            else
+                self->queued_.fetch_sub(1, std::memory_order_relaxed);
+        });
+    }
+
+private:
+    websocket::stream<beast::basic_stream<net::generic::stream_protocol>> ws_;
+    beast::flat_buffer buffer_;
+    Subscriptions *subscriptions_;
+    StorageWorkers *workers_;
+    Subscriptions::Topics topics_; // touched on the strand only
+    std::deque<std::shared_ptr<const std::string>> outbox_;
+    std::atomic<std::size_t> queued_{0}; // messages delivered and not written yet
+    std::atomic<bool> dropped_{false};
+
+    static std::size_t send_limit()
+    {
+        static const std::size_t limit = unit::env_u64("UNIT_WS_SEND_QUEUE", WS_SEND_QUEUE);
+        return limit;
+    }
+
+    static std::size_t max_subscriptions()
+    {
+        static const std::size_t limit = unit::env_u64("UNIT_WS_MAX_SUBSCRIPTIONS", WS_MAX_SUBSCRIPTIONS);
+        return limit;
+    }
+
+    // counts the message against the send queue limit and runs write on the strand, or drops the session
+    template<class Write>
+    void enqueue(Write write)
+    {
+        if (queued_.fetch_add(1, std::memory_order_relaxed) >= send_limit())
+        {
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            if (!dropped_.exchange(true))
+            {
+                auto self = shared_from_this();
+                net::post(ws_.get_executor(), [self]()
+                {
+                    beast::error_code ec;
+                    beast::get_lowest_layer(self->ws_).socket().close(ec); // too slow, a close frame would wait as well
+                });
+            }
+            return;
+        }
+        net::post(ws_.get_executor(), std::move(write));
+    }
+
+    void read()
+    {
+        auto self = shared_from_this();
+        ws_.async_read(buffer_, [self](beast::error_code ec, std::size_t)
+        {
+            if (ec)
+                return; // closed, timed out or dropped; subscriptions go away with the session
+            std::string message = beast::buffers_to_string(self->buffer_.data());
+            self->buffer_.consume(self->buffer_.size());
+            self->handle(message);
+            self->read();
+        });
+    }
+
+    void handle(const std::string &message)
+    {
+        boost::json::error_code ec;
+        boost::json::value json = boost::json::parse(message, ec);
+        if (ec || !json.is_object())
+        {
+            reply(R"({"message":"Failed to parse JSON"})");
+            return;
+        }
+        try
+        {
+            if (json.as_object().contains("unsubscribe"))
+                unsubscribe(json);
+            else
+                subscribe(json);
+        }
+        catch (std::exception &e)
+        {
+            reply(R"({"message":"Invalid data"})");
+        }
+    }
+
+    // subscribing again to what the connection is subscribed to changes nothing
+    void subscribe(const boost::json::value &json)
+    {
+        std::string topic = boost::json::value_to<std::string>(json.at("subscribe"));
+        auto self = shared_from_this();
+        if (topic == "newBlocks")
+        {
+            if (!topics_.blocks && !room_for_subscription())
+                return;
+            if (!topics_.blocks)
+                subscriptions_->subscribe_blocks(self);
+            topics_.blocks = true;
+        }
+        else if (topic == "txStatus")
+        {
+            std::optional<unit::Hash32> hash = unit::Hash32::from_hex(boost::json::value_to<std::string>(json.at("hash")));
+            if (!hash.has_value())
+            {
+                reply(R"({"message":"Invalid data"})");
+                return;
+            }
+            std::vector<unit::Hash32> &hashes = topics_.transactions;
+            if (std::find(hashes.begin(), hashes.end(), hash.value()) == hashes.end())
+            {
+                if (!room_for_subscription())
+                    return;
+                hashes.push_back(hash.value());
+                subscriptions_->subscribe_tx(hash.value(), self);
+                check_committed(hash.value());
+            }
+        }
+        else if (topic == "addressActivity")
+        {
+            std::string address = boost::json::value_to<std::string>(json.at("address"));
+            std::vector<std::string> &addresses = topics_.addresses;
+            if (std::find(addresses.begin(), addresses.end(), address) == addresses.end())
+            {
+                if (!room_for_subscription())
+                    return;
+                addresses.push_back(address);
+                subscriptions_->subscribe_address(address, self);
+            }
+        }
+        else
+        {
+            reply(R"({"message":"Topic not found"})");
+            return;
+        }
+        reply(R"({"message":"Ok","subscribed":")" + topic + "\"}");
+    }
+
+    // {"unsubscribe":"txStatus","hash":"0x..."} and the like, unsubscribing from what is not subscribed is no error
+    void unsubscribe(const boost::json::value &json)
+    {
+        std::string topic = boost::json::value_to<std::string>(json.at("unsubscribe"));
+        Subscriptions::Topics removed;
+        if (topic == "newBlocks")
+        {
+            removed.blocks = topics_.blocks;
+            topics_.blocks = false;
+        }
+        else if (topic == "txStatus")
+        {
+            std::optional<unit::Hash32> hash = unit::Hash32::from_hex(boost::json::value_to<std::string>(json.at("hash")));
+            if (!hash.has_value())
+            {
+                reply(R"({"message":"Invalid data"})");
+                return;
+            }
+            if (forget(topics_.transactions, hash.value()))
+                removed.transactions.push_back(hash.value());
+        }
+        else if (topic == "addressActivity")
+        {
+            std::string address = boost::json::value_to<std::string>(json.at("address"));
+            if (forget(topics_.addresses, address))
+                removed.addresses.push_back(address);
+        }
+        else
+        {
+            reply(R"({"message":"Topic not found"})");
+            return;
+        }
+        subscriptions_->unsubscribe(this, removed);
+        reply(R"({"message":"Ok","unsubscribed":")" + topic + "\"}");
+    }
+
+    bool room_for_subscription()
+    {
+        if (topics_.size() < max_subscriptions())
+            return true;
+        reply(R"({"message":"Too many subscriptions"})");
+        return false;
+    }
+
+    // false when value was not in list
+    template<class Value>
+    static bool forget(std::vector<Value> &list, const Value &value)
+    {
+        auto found = std::find(list.begin(), list.end(), value);
+        if (found == list.end())
+            return false;
+        list.erase(found);
+        return true;
+    }
+
+    // a transaction committed before the subscription would never fire, so it is looked up once
+    void check_committed(const unit::Hash32 &hash)
+    {
+        auto self = shared_from_this();
+        this->workers_->submit([self, hash]()
+        {
+            std::optional<std::string> block = unit::DB::find_transaction_block(hash);
+            if (!block.has_value())
+                return;
+            boost::json::value parsed = boost::json::parse(block.value());
+            boost::json::object event;
+            event["event"] = "txStatus";
+            event["hash"] = hash.to_hex();
+            event["status"] = "committed";
+            event["block_index"] = parsed.at("index");
+            event["block_hash"] = parsed.at("hash");
+            self->deliver_status(hash, std::make_shared<const std::string>(boost::json::serialize(event)));
+        });
+    }
+
+    void reply(std::string message)
+    {
+        queued_.fetch_add(1, std::memory_order_relaxed);
+        send(std::make_shared<const std::string>(std::move(message)));
+    }
+
+    // on the strand, one write at a time
+    void send(std::shared_ptr<const std::string> message)
+    {
+        outbox_.push_back(std::move(message));
+        if (outbox_.size() == 1)
+            write();
+    }
+
+    void write()
+    {
+        auto self = shared_from_this();
+        ws_.text(true);
+        ws_.async_write(net::buffer(*outbox_.front()), [self](beast::error_code ec, std::size_t)
+        {
+            self->outbox_.pop_front();
+            self->queued_.fetch_sub(1, std::memory_order_relaxed);
+            if (ec)
+            {
+                self->queued_.fetch_sub(self->outbox_.size(), std::memory_order_relaxed);
+                self->outbox_.clear();
+                return;
+            }
+            if (!self->outbox_.empty())
+                self->write();
+        });
+    }
+};
+
+// what connections work with, owned by start_server and the block handler
+struct server_context
+{
+    ValidationPipeline *pipeline;
+    Mempool *mempool;
+    StorageWorkers *workers;
+    Subscriptions *subscriptions;
+    AdmissionControl *admission;
+};
+
 class http_connection : public std::enable_shared_from_this<http_connection>
 {
 public:
-    http_connection(tcp::socket socket) : socket_(std::move(socket)){}
+    http_connection(stream_socket socket, std::string client) : client_(std::move(client)), socket_(std::move(socket)){}
 
     // Initiate the asynchronous operations associated with the connection.
-    void start(unit::list<Transaction> *tx_deque)
+    // Everything of a connection runs on its socket's strand, so handlers never run concurrently.
+    void start(const server_context &context)
     {
-        this->tx_deque = tx_deque;
-        read_request();
-        check_deadline();
+        this->pipeline = context.pipeline;
+        this->mempool = context.mempool;
+        this->workers = context.workers;
+        this->subscriptions = context.subscriptions;
+        this->admission = context.admission;
+        auto self = shared_from_this();
+        net::dispatch(socket_.get_executor(), [self]()
+        {
+            self->read_request();
+            self->check_deadline();
+        });
     }
 
 private:
     // pointer to tx deque
 //    std::vector<Transaction> *tx_deque;
-    unit::list<Transaction> *tx_deque;
+    // submitted transactions are validated there before they reach the mempool
+    ValidationPipeline *pipeline;
+    // pointer to the fee-ordered pool transactions are drained into
+    Mempool *mempool;
+    // blocking DB reads of requests run there, off the I/O threads
+    StorageWorkers *workers;
+    // events of committed blocks for WebSocket subscribers
+    Subscriptions *subscriptions;
+    // refuses submissions when the node or the client is over its limits
+    AdmissionControl *admission;
+    // address of the client, submissions are rate limited by it; clients of the Unix socket share HTTP_LOCAL_CLIENT
+    std::string client_;
+    // the response is written later, when the pipeline reports its verdict or a storage job completes
+    bool deferred_ = false;
     // The socket for the currently connected client.
-    tcp::socket socket_;
-    // The buffer for performing reads.
+    stream_socket socket_;
+    // The buffer for performing reads, kept for the whole connection. Bytes of pipelined requests read
+    // together with the current one wait here for the next read.
     beast::flat_buffer buffer_{8192};
     // The request message.
     http::request<http::string_body> request_;
-    // The response message.
-    http::response<http::dynamic_body> response_;
-    // The timer for putting a deadline on connection processing.
-    net::steady_timer deadline_{socket_.get_executor(), std::chrono::seconds(60)};
+    // The response message, its body keeps its capacity from request to request.
+    http::response<http::string_body> response_;
+    // Request JSON is parsed into this arena, which is reset for every request, so a usual request is parsed without
+    // touching the heap. Whatever outlives the request (submissions) is copied out to the default resource.
+    unsigned char parse_buffer_[HTTP_PARSE_BUFFER];
+    boost::json::monotonic_resource parse_resource_{parse_buffer_, sizeof(parse_buffer_)};
+    // Closes a connection idle for longer than the idle timeout: waiting for a request or for the client to
+    // take a response. Never expires while a request is processed.
+    net::steady_timer deadline_{socket_.get_executor()};
+    bool closed_ = false;
+    // A deferred request is answered with 503 when its answer does not come within the request timeout, the late
+    // answer is dropped then. Deferred requests are numbered, so that answer is never taken for the next one's.
+    net::steady_timer request_timer_{socket_.get_executor()};
+    uint64_t request_number_ = 0;
+    std::optional<uint64_t> awaited_;
+    // set when the request timed out, a storage job still queued for it is skipped
+    std::shared_ptr<std::atomic<bool>> request_expired_;
+
+    // answer produced off the connection's strand, turned into the response back on it
+    struct reply
+    {
+        bool ok;
+        std::string message;
+    };
+
+    static std::chrono::milliseconds idle_timeout()
+    {
+        static const std::chrono::milliseconds timeout{unit::env_u64("UNIT_HTTP_IDLE_TIMEOUT_MS", HTTP_IDLE_TIMEOUT_MS)};
+        return timeout;
+    }
+
+    static std::chrono::milliseconds request_timeout()
+    {
+        static const std::chrono::milliseconds timeout{unit::env_u64("UNIT_HTTP_REQUEST_TIMEOUT_MS", HTTP_REQUEST_TIMEOUT_MS)};
+        return timeout;
+    }
+
     // Asynchronously receive a complete request message.
     void read_request()
     {
         auto self = shared_from_this();
+        std::string body = std::move(request_.body()); // the parser appends to the body, keep its capacity
+        body.clear();
+        request_ = {};
+        request_.body() = std::move(body);
+        deadline_.expires_after(idle_timeout());
         http::async_read(
                 socket_,
                 buffer_,
@@ -79,19 +467,34 @@ private:
                        std::size_t bytes_transferred)
                 {
                     boost::ignore_unused(bytes_transferred);
-                    if (!ec)
-                        self->process_request();
+                    if (ec)
+                    {
+                        self->close(); // client went away, timed out or sent garbage
+                        return;
+                    }
+                    self->deadline_.expires_at(net::steady_timer::time_point::max());
+                    if (websocket::is_upgrade(self->request_))
+                    {
+                        self->upgrade();
+                        return;
+                    }
+                    self->process_request();
                 });
     }
 
     /*request*/
     void process_request()
     {
+        response_.clear(); // header fields only, the body buffer keeps its memory
+        response_.body().clear();
+        deferred_ = false;
         response_.version(request_.version());
-        response_.keep_alive(true);
+        response_.keep_alive(request_.keep_alive());
 
-        // featured json body
-        boost::json::value body_to_json;
+        // featured json body, in the arena of the connection
+        parse_resource_.release();
+        boost::json::storage_ptr arena(&parse_resource_);
+        boost::json::value body_to_json(arena);
 
         boost::json::error_code ec;
 
@@ -104,6 +507,12 @@ private:
                 break;
             case http::verb::post:
 
+                if (beast::iequals(request_[http::field::content_type], SUBMISSION_CONTENT_TYPE))
+                {
+                    push_binary();
+                    break;
+                }
+
                 /* parsing options not implemented (no overload for function parse) */
                 /*
                 boost::json::parse_options opt;
@@ -111,7 +520,7 @@ private:
                 opt.allow_trailing_commas = true;
                 */
 
-                body_to_json = boost::json::parse(request_.body());
+                body_to_json = boost::json::parse(request_.body(), ec, arena);
 
                 // parsing failed
                 if (ec)
@@ -128,61 +537,177 @@ private:
                 create_error_response(R"({"message":"Invalid request type"})");
                 break;
         }
-        write_response();
+        if (!deferred_)
+            write_response();
     }
 
     /* RESPONSES */
     /*-----------*/
-    void create_error_response(std::string message = R"({"message":"Error"})", bool isJSON = true)
+    void create_error_response(std::string_view message = R"({"message":"Error"})", bool isJSON = true)
     {
         response_.result(http::status::bad_request);
         response_.set(http::field::content_type, (isJSON ? "application/json" : "text/plain"));
         response_.set(http::field::server, "Unit");
-        beast::ostream(response_.body()) << message;
+        response_.body().append(message);
     }
-    void create_success_response(std::string message = R"({"message":"Ok"})", bool isJSON = true)
+    void create_success_response(std::string_view message = R"({"message":"Ok"})", bool isJSON = true)
     {
         response_.result(http::status::ok);
         response_.set(http::field::content_type, (isJSON ? "application/json" : "text/plain"));
         response_.set(http::field::server, "Unit");
-        beast::ostream(response_.body()) << message;
+        response_.body().append(message);
     }
+    void create_unavailable_response(std::string_view message, uint64_t retry_after_s = 1)
+    {
+        create_retry_response(http::status::service_unavailable, message, retry_after_s);
+    }
+    void create_retry_response(http::status status, std::string_view message, uint64_t retry_after_s)
+    {
+        response_.result(status);
+        response_.set(http::field::content_type, "application/json");
+        response_.set(http::field::server, "Unit");
+        response_.set(http::field::retry_after, std::to_string(retry_after_s));
+        response_.body().append(message);
+    }
+    // the next request is read once the response is out, so pipelined requests are answered in order
     void write_response()
     {
         auto self = shared_from_this();
         response_.content_length(response_.body().size());
+        deadline_.expires_after(idle_timeout());
         http::async_write(
                 socket_,
                 response_,
                 [self](beast::error_code ec, std::size_t)
                 {
-                    self->socket_.shutdown(tcp::socket::shutdown_send, ec);
-                    self->deadline_.cancel();
+                    if (ec)
+                    {
+                        self->close();
+                        return;
+                    }
+                    if (self->response_.need_eof())
+                    {
+                        self->socket_.shutdown(stream_socket::shutdown_send, ec);
+                        self->close();
+                        return;
+                    }
+                    self->read_request();
                 });
     }
     void check_deadline()
     {
+        if (closed_)
+            return;
+        if (deadline_.expiry() <= net::steady_timer::clock_type::now())
+        {
+            beast::error_code ec;
+            socket_.close(ec); // pending read or write completes with an error and closes the connection
+            return;
+        }
         auto self = shared_from_this();
         deadline_.async_wait(
-                [self](beast::error_code ec)
+                [self](beast::error_code)
                 {
-                    if (!ec)
-                    {
-                        self->socket_.close(ec);
-                    }
+                    self->check_deadline();
                 });
     }
+    // the socket is handed over to a WebSocket session, this connection is done
+    void upgrade()
+    {
+        close();
+        std::make_shared<websocket_session>(std::move(socket_), this->subscriptions, this->workers)->run(std::move(request_));
+    }
+    // the connection is released once its last handler completes
+    void close()
+    {
+        closed_ = true;
+        deadline_.cancel();
+        request_timer_.cancel();
+    }
+
+    // the response is written by whoever answers the returned request number, or by the request timer
+    uint64_t defer()
+    {
+        deferred_ = true;
+        uint64_t number = ++request_number_;
+        awaited_ = number;
+        std::shared_ptr<std::atomic<bool>> expired = request_expired_ = std::make_shared<std::atomic<bool>>(false);
+        auto self = shared_from_this();
+        request_timer_.expires_after(request_timeout());
+        request_timer_.async_wait([self, number, expired](beast::error_code ec)
+        {
+            if (ec || !self->answer(number))
+                return;
+            expired->store(true, std::memory_order_relaxed);
+            self->create_unavailable_response(R"({"message":"Request timed out"})");
+            self->write_response();
+        });
+        return number;
+    }
+
+    // false when the request was already answered (timed out), its answer must be dropped then
+    bool answer(uint64_t number)
+    {
+        if (awaited_ != number)
+            return false;
+        awaited_.reset();
+        request_timer_.cancel();
+        return true;
+    }
+
+    // Runs job on the storage workers and writes its reply, the connection's strand is free meanwhile.
+    void run_on_storage(std::function<reply()> job)
+    {
+        auto self = shared_from_this();
+        uint64_t number = defer();
+        std::shared_ptr<std::atomic<bool>> expired = request_expired_;
+        bool queued = this->workers->submit([self, number, expired, job = std::move(job)]()
+        {
+            if (expired->load(std::memory_order_relaxed))
+                return; // answered with a timeout while queued
+            reply result;
+            try
+            {
+                result = job();
+            }
+            catch (std::exception &e)
+            {
+                result = {false, R"({"message":"Storage error"})"};
+            }
+            net::post(self->socket_.get_executor(), [self, number, result = std::move(result)]()
+            {
+                if (!self->answer(number))
+                    return;
+                if (result.ok)
+                    self->create_success_response(result.message);
+                else
+                    self->create_error_response(result.message);
+                self->write_response();
+            });
+        });
+        if (!queued)
+        {
+            answer(number);
+            deferred_ = false;
+            create_unavailable_response(R"({"message":"Server is busy, please try again later"})");
+        }
+    }
     /* END OF RESPONSES */
     /*------------------*/
 
     /*INSTRUCTIONS*/
     /*------------*/
-    void process_instruction(boost::json::value json)
+    void process_instruction(const boost::json::value &json)
     {
         try
         {
-            std::string instruction;
-            instruction = boost::json::value_to<std::string>(json.at("instruction"));
+            const boost::json::string *name = json.at("instruction").if_string();
+            if (name == nullptr)
+            {
+                create_error_response(R"({"message":"Instruction not found"})");
+                return;
+            }
+            std::string_view instruction = *name;
             if (instruction == "i_balance")
             {
                 i_balance(json);
@@ -196,6 +721,15 @@ private:
                     return;
                 }
             }
+            else if (instruction == "i_push_transactions")
+            {
+                try {
+                    i_push_transactions(json);
+                } catch (std::exception &e) {
+                    create_error_response(R"({"message":"Invalid data"})");
+                    return;
+                }
+            }
             else if (instruction == "i_block_height")
             {
                 i_block_height();
@@ -204,6 +738,14 @@ private:
             {
                 i_tx(json);
             }
+            else if (instruction == "i_nonce")
+            {
+                i_nonce(json);
+            }
+            else if (instruction == "i_tx_proof")
+            {
+                i_tx_proof(json);
+            }
             else if (instruction == "i_pool_size"){
                 i_pool_size();
             }
@@ -218,17 +760,19 @@ private:
         }
     }
 
-    void i_balance(boost::json::value json)
+    void i_balance(const boost::json::value &json)
     {
         try
         {
             std::string name;
             name = boost::json::value_to<std::string>(json.at("data").at("name"));
-            std::optional<std::string> op_balance = unit::DB::get_balance(name);
-            if (!op_balance.has_value())
-                create_error_response(R"({"message":"Balance not found, address: )" + name + "\"}");
-            else
-                create_success_response(R"({"message":"Ok","balance":)" + op_balance.value() + "}");
+            run_on_storage([name]() mutable -> reply
+            {
+                std::optional<std::string> op_balance = unit::DB::get_balance(name);
+                if (!op_balance.has_value())
+                    return {false, R"({"message":"Balance not found, address: )" + name + "\"}"};
+                return {true, R"({"message":"Ok","balance":)" + op_balance.value() + "}"};
+            });
         }
         catch (const boost::wrapexcept<std::out_of_range> &o)
         {
@@ -236,293 +780,383 @@ private:
         }
     }
 
-    bool isEnoughTokenBalance(const boost::json::value& balance, const std::string& token_name, double value) {
-        boost::json::object balance_json = balance.as_object();
-        for(boost::json::array::iterator it = balance_json.at("tokens_balance").as_array().begin(); it != balance_json.at("tokens_balance").as_array().end(); ++it){
-            if(it->as_object().contains(token_name)) {
-                if(boost::json::value_to<double>(it->at(token_name)) < value)
-                    return false;
-                return true;
-            }
+    // next nonce the address should use, counting its pending transactions
+    void i_nonce(const boost::json::value &json)
+    {
+        try
+        {
+            std::string name;
+            name = boost::json::value_to<std::string>(json.at("data").at("name"));
+            Mempool *pool = this->mempool;
+            run_on_storage([name, pool]() mutable -> reply
+            {
+                std::optional<std::string> op_balance = unit::DB::get_balance(name);
+                if (!op_balance.has_value())
+                    return {false, R"({"message":"Balance not found, address: )" + name + "\"}"};
+                uint64_t account_nonce = WalletAccount::getNonce(boost::json::parse(op_balance.value()));
+                std::pair<uint64_t, uint64_t> nonces = pool->nonce_range(name, account_nonce);
+                return {true, R"({"message":"Ok","account_nonce":)" + std::to_string(account_nonce) + R"(,"nonce":)" + std::to_string(nonces.second) + "}"};
+            });
+        }
+        catch (const boost::wrapexcept<std::out_of_range> &o)
+        {
+            create_error_response(R"({"message":"Invalid data"})");
         }
-        return false;
     }
 
-    bool isEnoughUnitBalance(const boost::json::value& balance, double value) {
-        if(boost::json::value_to<double>(balance.at("amount")) < value)
-            return false;
-        return true;
+    void i_push_transaction(const boost::json::value &json)
+    {
+        boost::json::value data(json.at("data"), boost::json::storage_ptr()); // outlives the request arena
+        if (!admit(1))
+            return;
+        uint64_t number = defer();
+        finish_submission(number, 1, this->pipeline->submit(std::move(data), verdict_callback(number)));
     }
 
-    void i_push_transaction(boost::json::value json)
+    // the batch is answered with one result per transaction, in the order they were sent
+    void i_push_transactions(const boost::json::value &json)
     {
-        try
+        boost::json::array items(json.at("data").as_array(), boost::json::storage_ptr()); // outlives the request arena
+        std::size_t count = items.size();
+        if (!check_batch_size(count) || !admit(count))
+            return;
+        uint64_t number = defer();
+        finish_submission(number, count, this->pipeline->submit_batch(std::move(items), batch_callback(number)));
+    }
+
+    // binary body (ValidationPipeline::decode_binary): one record is answered like i_push_transaction,
+    // more like i_push_transactions
+    void push_binary()
+    {
+        std::vector<ValidationPipeline::Submission> submissions;
+        std::string error;
+        if (!ValidationPipeline::decode_binary(request_.body(), submissions, error))
         {
-            std::string type;
-            type = std::to_string(boost::json::value_to<int>(json.at("data").at("type")));
-            if (type.length() == 0)
-            {
-                create_error_response(R"({"message":"'type' field is invalid"})");
-                return;
-            }
+            boost::json::object message;
+            message["message"] = "Invalid data: " + error;
+            create_error_response(boost::json::serialize(message));
+            return;
+        }
+        std::size_t count = submissions.size();
+        if (!check_batch_size(count) || !admit(count))
+            return;
+        uint64_t number = defer();
+        if (count == 1)
+        {
+            submissions.front().done = verdict_callback(number);
+            finish_submission(number, 1, this->pipeline->submit_decoded(std::move(submissions.front())));
+            return;
+        }
+        finish_submission(number, count, this->pipeline->submit_batch(std::move(submissions), batch_callback(number)));
+    }
 
-            std::string from;
-            from = boost::json::value_to<std::string>(json.at("data").at("from"));
-            if (from.length() == 0)
-            {
-                create_error_response(R"({"message":"'from' field is invalid"})");
-                return;
-            }
+    bool check_batch_size(std::size_t size)
+    {
+        if (size > 0 && size <= this->pipeline->max_batch())
+            return true;
+        create_error_response(R"({"message":"Batch must have from 1 to )" + std::to_string(this->pipeline->max_batch()) + R"( transactions"})");
+        return false;
+    }
 
-            std::optional<std::string> u_balance = unit::DB::get_balance(from);
-            if (!u_balance.has_value())
-            {
-                create_error_response(R"({"message":"Balance not found, address: )" + from + "\"}");
-                return;
-            }
+    // false when the node or the client is over its limits, the response is created then
+    bool admit(std::size_t transactions)
+    {
+        uint64_t retry_after_s = 0;
+        switch (this->admission->admit(client_, transactions, &retry_after_s))
+        {
+            case AdmissionControl::ADMITTED:
+                return true;
+            case AdmissionControl::RATE_LIMITED:
+                create_retry_response(http::status::too_many_requests, R"({"message":"Too many transactions, please slow down"})", retry_after_s);
+                break;
+            case AdmissionControl::OVERLOADED:
+                create_unavailable_response(R"({"message":"Node is overloaded, please try again later"})", retry_after_s);
+                break;
+            case AdmissionControl::SATURATED:
+                create_unavailable_response(R"({"message":"Transaction pool is full, please try again later"})", retry_after_s);
+                break;
+            case AdmissionControl::TOO_LARGE:
+                create_error_response(R"({"message":"Batch must have at most )" + std::to_string(this->admission->max_batch()) + R"( transactions"})");
+                break;
+        }
+        return false;
+    }
 
-            if (type == "0")
+    // verdicts come from pipeline threads, the response is written on the connection's executor
+    ValidationPipeline::Callback verdict_callback(uint64_t number)
+    {
+        auto self = shared_from_this();
+        return [self, number](const ValidationPipeline::Verdict &verdict)
+        {
+            self->admission->release(1);
+            net::post(self->socket_.get_executor(), [self, number, verdict]()
             {
-                std::string to;
-                to = boost::json::value_to<std::string>(json.at("data").at("to"));
-                if (to.length() == 0)
-                {
-                    create_error_response(R"({"message":"'to' field is invalid"})");
-                    return;
-                }
-
-                std::string amount;
-                amount = std::to_string(boost::json::value_to<double>(json.at("data").at("amount")));
-                if (amount.length() == 0)
-                {
-                    create_error_response(R"({"message":"'amount' field is invalid"})");
+                if (!self->answer(number))
                     return;
-                }
+                self->create_verdict_response(verdict);
+                self->write_response();
+            });
+        };
+    }
 
-                double d_amount;
-                try
-                {
-                    d_amount = std::stod(amount);
-                }
-                catch (const std::exception &e)
-                {
-                    create_error_response(R"({"message":"Invalid amount"})");
+    ValidationPipeline::BatchCallback batch_callback(uint64_t number)
+    {
+        auto self = shared_from_this();
+        return [self, number](std::vector<ValidationPipeline::Verdict> verdicts)
+        {
+            self->admission->release(verdicts.size());
+            net::post(self->socket_.get_executor(), [self, number, verdicts = std::move(verdicts)]()
+            {
+                if (!self->answer(number))
                     return;
-                }
+                self->create_batch_response(verdicts);
+                self->write_response();
+            });
+        };
+    }
 
-                std::map<std::string, std::string> extradata = {{"name", "null"},
-                                                                {"value", "null"},
-                                                                {"bytecode", "null"}};
+    // a submission refused by the pipeline is answered right away
+    void finish_submission(uint64_t number, std::size_t transactions, bool submitted)
+    {
+        if (submitted)
+            return;
+        this->admission->release(transactions);
+        answer(number);
+        deferred_ = false;
+        create_unavailable_response(R"({"message":"Transaction pool is full, please try again later"})");
+    }
 
-                std::optional<std::string> op_balance = unit::DB::get_balance(from);
-                if(op_balance->empty()) {
-                    std::string response = R"({"message":"Error occurred, please try again"})";
-                    create_error_response(response);
-                }
+    void create_batch_response(const std::vector<ValidationPipeline::Verdict> &verdicts)
+    {
+        boost::json::array results;
+        std::size_t accepted = 0;
+        for (const ValidationPipeline::Verdict &verdict : verdicts)
+        {
+            boost::json::object result;
+            result["accepted"] = verdict.accepted;
+            result["message"] = verdict.message;
+            if (!verdict.hash.is_zero())
+                result["hash"] = verdict.hash.to_hex();
+            results.push_back(std::move(result));
+            accepted += verdict.accepted;
+        }
+        boost::json::object message;
+        message["message"] = "Ok";
+        message["accepted"] = accepted;
+        message["rejected"] = verdicts.size() - accepted;
+        message["results"] = std::move(results);
+        create_success_response(boost::json::serialize(message));
+    }
 
-                if(!isEnoughUnitBalance(boost::json::parse(op_balance.value()), boost::json::value_to<double>(json.at("data").at("amount")))) {
-                    std::string response = R"({"message":"Error occurred, please try again"})";
-                    create_error_response(response);
-                    return;
-                }
+    void create_verdict_response(const ValidationPipeline::Verdict &verdict)
+    {
+        if (verdict.accepted)
+        {
+            create_success_response(R"({"message":"Ok","hash":")" + verdict.hash.to_hex() + R"("})");
+            return;
+        }
+        boost::json::object message;
+        message["message"] = verdict.message;
+        if (!verdict.hash.is_zero())
+            message["hash"] = verdict.hash.to_hex();
+        create_error_response(boost::json::serialize(message));
+    }
 
+    void i_block_height()
+    {
+        run_on_storage([]() -> reply
+        {
+            std::optional<std::string> block_height = unit::DB::get_block_height();
+            if (!block_height.has_value())
+                return {false, R"({"message":"Error"})"};
+            return {true, R"({"message":"Ok","block_height":)" + block_height.value() + "}"};
+        });
+    }
+    void i_pool_size()
+    {
+        std::size_t queued = this->pipeline->pending();
+        create_success_response(R"({"message":"Ok","pool_size":)" + std::to_string(queued + this->mempool->size()) + R"(,"queued":)" + std::to_string(queued) + R"(,"pipeline":)" + this->pipeline->stats_to_json_string() + R"(,"mempool":)" + this->mempool->stats_to_json_string() + R"(,"admission":)" + this->admission->stats_to_json_string() + "}");
+    }
 
-                Transaction tx = Transaction(from, to, 0, json.at("data").at("extradata"), "0", d_amount);
-                tx.generate_tx_hash();
-                this->tx_deque->push_back(tx);
-                std::string response = R"({"message":"Ok","hash":")" + tx.getHash() + R"("})";
-                create_success_response(response);
+    void i_tx(const boost::json::value &json)
+    {
+        try
+        {
+            std::optional<unit::Hash32> hash = unit::Hash32::from_hex(boost::json::value_to<std::string>(json.at("data").at("hash")));
+            if (!hash.has_value())
+            {
+                create_error_response(R"({"message":"Invalid data"})");
                 return;
             }
-            else if (type == "1")
+            run_on_storage([hash = hash.value()]() -> reply
             {
-                std::string bytecode;
-                std::string decoded_bytecode;
-                bytecode = boost::json::value_to<std::string>(json.at("data").at("extradata").at("bytecode"));
-                if (bytecode.length() == 0)
-                {
-                    create_error_response(R"({"message":"'bytecode' field is invalid"})");
-                    return;
-                }
-                try
-                {
-                    decoded_bytecode = boost::algorithm::unhex(bytecode);
-                }
-                catch (const boost::algorithm::hex_decode_error &e)
-                {
-                    create_error_response(R"({"message":"Bytecode decoding error"})");
-                    return;
-                }
-
-                boost::json::error_code ec;
-                boost::json::value bytecode_to_json = boost::json::parse(decoded_bytecode, ec);
-                // parsing failed
-                if (ec)
-                {
-                    create_error_response(R"({"message":"Failed to parse bytecode to JSON"})");
-                    return;
-                }
-
-                std::string name;
-                std::string supply;
-                try
-                {
-                    name = boost::json::value_to<std::string>(bytecode_to_json.at("name"));
-                    supply = std::to_string(boost::json::value_to<double>(bytecode_to_json.at("supply")));
-                }
-                catch (const boost::wrapexcept<std::out_of_range> &e)
-                {
-                    create_error_response(R"({"message":"Not enough fields in bytecode data"})");
-                    return;
-                }
-
-                if (name.length() == 0)
-                {
-                    create_error_response(R"({"message":"Bytecode error: 'name' is empty"})");
-                    return;
-                }
-                if (supply.length() == 0)
-                {
-                    create_error_response(R"({"message":"Bytecode error: 'supply' is empty"})");
-                    return;
-                }
-
-                try
-                {
-                    double r = std::stod(supply);
-                }
-                catch (const std::exception &e)
-                {
-                    create_error_response(R"({"message":"Bytecode error: 'supply' is not a number"})");
-                    return;
-                }
-
-//                std::map<std::string, std::string> extradata = {{"name", "null"},
-//                                                                {"value", "null"},
-//                                                                {"bytecode", bytecode}};
+                std::optional<std::string> op_tx = unit::DB::find_transaction(hash);
+                if (!op_tx.has_value())
+                    return {false, R"({"message":"Transaction not found"})"};
+                return {true, R"({"message":"Ok","transaction":)" + op_tx.value() + "}"};
+            });
+        }
+        catch (const boost::wrapexcept<std::out_of_range> &o)
+        {
+            create_error_response(R"({"message":"Invalid data"})");
+        }
+    }
 
-                Transaction tx = Transaction(from, "", 1, json.at("data").at("extradata"), "0", 0);
-                tx.generate_tx_hash();
-                this->tx_deque->push_back(tx);
-                std::string response = R"({"message":"Ok","hash":")" + tx.getHash() + R"("})";
-                create_success_response(response);
+    // Merkle inclusion proof of a committed transaction: siblings from the leaf up to the block hash
+    void i_tx_proof(const boost::json::value &json)
+    {
+        try
+        {
+            std::optional<unit::Hash32> hash = unit::Hash32::from_hex(boost::json::value_to<std::string>(json.at("data").at("hash")));
+            if (!hash.has_value())
+            {
+                create_error_response(R"({"message":"Invalid data"})");
                 return;
             }
-            else if (type == "2")
+            run_on_storage([hash = hash.value()]() -> reply
             {
-                std::string to;
-                to = boost::json::value_to<std::string>(json.at("data").at("to"));
-                if (to.length() == 0)
-                {
-                    create_error_response(R"({"message":"'to' field is invalid"})");
-                    return;
-                }
-
-                std::string name;
-                name = boost::json::value_to<std::string>(json.at("data").at("extradata").at("name"));
-                if (name.length() == 0)
-                {
-                    create_error_response(R"({"message":"'name' field is invalid"})");
-                    return;
-                }
-
-                std::string value;
-                value = boost::json::value_to<std::string>(json.at("data").at("extradata").at("value"));
-                if (value.length() == 0)
-                {
-                    create_error_response(R"({"message":"'value' field is invalid"})");
-                    return;
-                }
-
-                double d_value;
-                try
-                {
-                    d_value = std::stod(value);
-                }
-                catch (const std::exception &e)
-                {
-                    create_error_response(R"({"message":"'value' field is not a number"})");
-                    return;
-                }
+                return tx_proof(hash);
+            });
+        }
+        catch (const boost::wrapexcept<std::out_of_range> &o)
+        {
+            create_error_response(R"({"message":"Invalid data"})");
+        }
+    }
 
-                std::map<std::string, std::string> extradata = {{"name", name},
-                                                                {"value", value},
-                                                                {"bytecode", "null"}};
+    // runs on a storage worker
+    static reply tx_proof(const unit::Hash32 &hash)
+    {
+        try
+        {
+            std::optional<std::string> op_block = unit::DB::find_transaction_block(hash);
+            if (!op_block.has_value())
+                return {false, R"({"message":"Transaction not found"})"};
 
-                std::optional<std::string> op_balance = unit::DB::get_balance(from);
-                if(op_balance->empty()) {
-                    std::string response = R"({"message":"Error occurred, please try again"})";
-                    create_error_response(response);
-                }
+            boost::json::value block = boost::json::parse(op_block.value());
+            std::string net_version = boost::json::value_to<std::string>(block.at("net_version"));
+            if (std::stoi(net_version) < MERKLE_FLAT_NET_VERSION)
+                return {false, R"({"message":"Proofs are not available for blocks of version )" + net_version + "\"}"};
 
-                if(!isEnoughTokenBalance(boost::json::parse(op_balance.value()), boost::json::value_to<std::string>(json.at("data").at("extradata").at("name")), std::stod(boost::json::value_to<std::string>(json.at("data").at("extradata").at("value"))))) {
-                    std::string response = R"({"message":"Low balance"})";
-                    create_error_response(response);
-                    return;
-                }
+            const boost::json::array &transactions = block.at("transactions").as_array();
+            std::vector<MerkleTree::Digest> leaves;
+            leaves.reserve(transactions.size());
+            std::size_t index = transactions.size();
+            for (std::size_t i = 0; i < transactions.size(); ++i)
+            {
+                unit::Hash32 tx_hash = unit::Hash32::from_hex(boost::json::value_to<std::string>(transactions[i])).value();
+                if (tx_hash == hash)
+                    index = i;
+                leaves.push_back(tx_hash);
+            }
+            if (index == transactions.size())
+                return {false, R"({"message":"Transaction not found"})"};
 
-                Transaction tx = Transaction(from, to, 2, json.at("data").at("extradata"), "0", 0);
-                tx.generate_tx_hash();
-                this->tx_deque->push_back(tx);
-                std::string response = R"({"message":"Ok","hash":")" + tx.getHash() + R"("})";
-                create_success_response(response);
-                return;
+            MerkleTree tree = MerkleTree(std::move(leaves));
+            boost::json::array proof;
+            for (const MerkleTree::ProofStep &step : tree.proof(index))
+            {
+                boost::json::object node;
+                node["hash"] = step.sibling.to_hex();
+                node["position"] = step.left ? "left" : "right";
+                proof.push_back(std::move(node));
             }
-            create_error_response(R"({"message":"No such type"})");
+
+            boost::json::object response;
+            response["message"] = "Ok";
+            response["block_hash"] = block.at("hash");
+            response["block_index"] = block.at("index");
+            response["root"] = tree.get_root().value().to_hex();
+            response["leaf"] = tree.getNodes()[index].to_hex();
+            response["index"] = index;
+            response["leaves"] = tree.leaf_count();
+            response["proof"] = std::move(proof);
+            return {true, boost::json::serialize(response)};
         }
-        catch (const boost::wrapexcept<std::out_of_range> &o)
+        catch (std::exception &e)
         {
-            create_error_response(R"({"message":"Data is invalid"})");
+            return {false, R"({"message":"Block data is invalid"})"};
         }
     }
+    /*END OF INSTRUCTIONS*/
+    /*-------------------*/
+};
 
-    void i_block_height()
+std::string client_address(const tcp::socket &socket)
+{
+    beast::error_code ec;
+    return socket.remote_endpoint(ec).address().to_string();
+}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+std::string client_address(const net::local::stream_protocol::socket &)
+{
+    return HTTP_LOCAL_CLIENT;
+}
+#endif
+
+// "Loop" forever accepting new connections, every one gets a strand of its own.
+// Both listeners, TCP and the Unix domain socket, accept through it into the same context.
+template <class Acceptor>
+void http_server(Acceptor &acceptor, net::io_context &ioc, const server_context &context)
+{
+    acceptor.async_accept(net::make_strand(ioc),
+                          [&acceptor, &ioc, &context](beast::error_code ec, typename Acceptor::protocol_type::socket socket)
+                          {
+                              if (!ec)
+                              {
+                                  std::string client = client_address(socket);
+                                  std::make_shared<http_connection>(stream_socket(std::move(socket)), std::move(client))->start(context);
+                              }
+                              http_server(acceptor, ioc, context);
+                          });
+}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+// Optional listener for clients on the same host, skipping the TCP stack. A socket file left by a previous run
+// is replaced; when the path is taken by anything else or cannot be bound the node serves TCP only.
+std::unique_ptr<net::local::stream_protocol::acceptor> local_listener(net::io_context &ioc, const std::string &path)
+{
+    struct stat status{};
+    if (::lstat(path.c_str(), &status) == 0)
     {
-        std::optional<std::string> block_height = unit::DB::get_block_height();
-        if (!block_height.has_value())
-            create_error_response();
-        else
-            create_success_response(R"({"message":"Ok","block_height":)" + block_height.value() + "}");
+        if (!S_ISSOCK(status.st_mode))
+        {
+            std::cout << "Error: " << path << " exists and is not a socket, Unix socket listener is disabled" << std::endl;
+            return nullptr;
+        }
+        ::unlink(path.c_str());
     }
-    void i_pool_size()
+    try
+    {
+        return std::make_unique<net::local::stream_protocol::acceptor>(ioc, net::local::stream_protocol::endpoint(path));
+    }
+    catch (std::exception const &e)
     {
-        create_success_response(R"({"message":"Ok","pool_size":)" + std::to_string(this->tx_deque->size()) + "}");
+        std::cout << "Error: could not listen on " << path << ": " << e.what() << std::endl;
+        return nullptr;
     }
+}
+#endif
 
-    void i_tx(boost::json::value json)
+// a throwing handler is reported and the thread goes back to serving
+void run_io(net::io_context &ioc)
+{
+    for (;;)
     {
         try
         {
-            std::string hash;
-            hash = boost::json::value_to<std::string>(json.at("data").at("hash"));
-            std::optional<std::string> op_tx = unit::DB::find_transaction(hash);
-            if (!op_tx.has_value())
-                create_error_response(R"({"message":"Transaction not found"})");
-            else
-                create_success_response(R"({"message":"Ok","transaction":)" + op_tx.value() + "}");
+            ioc.run();
+            return;
         }
-        catch (const boost::wrapexcept<std::out_of_range> &o)
+        catch (std::exception const &e)
         {
-            create_error_response(R"({"message":"Invalid data"})");
+            std::cerr << "Error: " << e.what() << std::endl;
         }
     }
-    /*END OF INSTRUCTIONS*/
-    /*-------------------*/
-};
-
-// "Loop" forever accepting new connections.
-void http_server(tcp::acceptor &acceptor, tcp::socket &socket, unit::list<Transaction> *tx_deque)
-{
-    acceptor.async_accept(socket,
-                          [&, tx_deque](beast::error_code ec)
-                          {
-                              if (!ec)
-                                  std::make_shared<http_connection>(std::move(socket))->start(tx_deque);
-                              http_server(acceptor, socket, tx_deque);
-                          });
 }
 
-int Server::start_server(unit::list<Transaction> *tx_deque)
+int Server::start_server(ValidationPipeline *pipeline, Mempool *mempool, Subscriptions *subscriptions)
 {
 // http_connection::initialize_instructions();
     rerun_server:
@@ -533,12 +1167,35 @@ int Server::start_server(unit::list<Transaction> *tx_deque)
         std::string ip_address = LOCAL_IP;
         auto const address = net::ip::make_address(ip_address);
         uint16_t port = PORT;
-        net::io_context ioc{1};
+        auto threads = static_cast<int>(std::max<uint64_t>(unit::env_u64("UNIT_HTTP_THREADS", std::thread::hardware_concurrency()), 1));
+        net::io_context ioc{threads};
         tcp::acceptor acceptor{ioc, {address, port}};
-        tcp::socket socket{ioc};
-        http_server(acceptor, socket, tx_deque);
-        std::cout << "Server has been started" << std::endl;
-        ioc.run();
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        std::string local_path = unit::env_string("UNIT_HTTP_UNIX_SOCKET", "");
+        std::unique_ptr<net::local::stream_protocol::acceptor> local_acceptor;
+        if (!local_path.empty())
+            local_acceptor = local_listener(ioc, local_path);
+#endif
+        StorageWorkers workers(unit::env_u64("UNIT_HTTP_DB_THREADS", STORAGE_WORKER_THREADS), unit::env_u64("UNIT_HTTP_DB_QUEUE_CAPACITY", STORAGE_QUEUE_CAPACITY));
+        workers.start();
+        AdmissionControl admission(mempool, pipeline);
+        server_context context{pipeline, mempool, &workers, subscriptions, &admission};
+        http_server(acceptor, ioc, context);
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        if (local_acceptor)
+        {
+            http_server(*local_acceptor, ioc, context);
+            std::cout << "Listening on Unix socket " << local_path << std::endl;
+        }
+#endif
+        std::cout << "Server has been started, " << threads << " threads" << std::endl;
+        std::vector<std::thread> io_threads;
+        io_threads.reserve(threads - 1);
+        for (int i = 1; i < threads; ++i)
+            io_threads.emplace_back(run_io, std::ref(ioc));
+        run_io(ioc);
+        for (std::thread &thread : io_threads)
+            thread.join();
     }
     catch (std::exception const &e)
     {
@@ -7,14 +7,21 @@
 #include "../Blockchain_core/Transaction.h"
 #include "../Blockchain_core/Hex.h"
 #include "../Blockchain_core/DB/DB.h"
-#include "../containers/list.h"
+#include "../Blockchain_core/Mempool/Mempool.h"
+#include "../Blockchain_core/Mempool/ValidationPipeline.h"
+#include "Subscriptions.h"
 
 #define LOCAL_IP "127.0.0.1"
 #define PORT 29000
+#define HTTP_IDLE_TIMEOUT_MS 30000 // keep-alive connection without a request in flight
+#define SUBMISSION_CONTENT_TYPE "application/x-unit-tx" // POST body in the binary submission format
+#define HTTP_PARSE_BUFFER 4096 // bytes of parsed request JSON per connection before the arena goes to the heap
+#define HTTP_REQUEST_TIMEOUT_MS 10000 // until a request waiting for storage or the pipeline is answered with 503
+#define HTTP_LOCAL_CLIENT "unix" // client address of connections on the Unix domain socket listener
 
 class Server {
 public:
-    static int start_server(unit::list<Transaction> *tx_deque);
+    static int start_server(ValidationPipeline *pipeline, Mempool *mempool, Subscriptions *subscriptions);
     static bool isEnoughTokenBalance(const boost::json::value& balance, const std::string& token_name, double value);
     static bool isEnoughUnitBalance(const boost::json::value& balance, double value);
 };
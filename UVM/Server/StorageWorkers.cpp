@@ -0,0 +1,35 @@
+#include "StorageWorkers.h"
+#include "iostream"
+
+StorageWorkers::StorageWorkers(std::size_t threads, std::size_t capacity) : threads(threads == 0 ? 1 : threads), queue(capacity) {}
+
+StorageWorkers::~StorageWorkers() {
+    this->queue.close();
+    for (std::thread &worker : this->workers)
+        worker.join();
+}
+
+void StorageWorkers::start() {
+    for (std::size_t i = 0; i < this->threads; ++i)
+        this->workers.emplace_back(&StorageWorkers::work, this);
+}
+
+bool StorageWorkers::submit(Job job) {
+    return this->queue.try_push(std::move(job));
+}
+
+std::size_t StorageWorkers::pending() const {
+    return this->queue.size();
+}
+
+void StorageWorkers::work() {
+    Job job;
+    while (this->queue.pop(job)) {
+        try {
+            job();
+        } catch (std::exception &e) {
+            std::cout << "Error: storage job failed: " << e.what() << std::endl;
+        }
+        job = nullptr; // release what the job holds (the connection) before waiting for the next one
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef UVM_STORAGEWORKERS_H
+#define UVM_STORAGEWORKERS_H
+#include "functional"
+#include "thread"
+#include "vector"
+#include "../containers/bounded_queue.h"
+
+#define STORAGE_WORKER_THREADS 4
+#define STORAGE_QUEUE_CAPACITY 1024
+
+// Threads running the blocking RocksDB reads of HTTP requests, so a slow read (get_balance retries for seconds)
+// never holds an I/O thread. The queue is bounded: when it is full, submit() refuses the job and the request
+// is answered with 503 right away instead of piling up.
+class StorageWorkers {
+public:
+    typedef std::function<void()> Job;
+
+    StorageWorkers(std::size_t threads, std::size_t capacity);
+    virtual ~StorageWorkers();
+
+    void start();
+    // false when the queue is full, the job is not run in that case
+    bool submit(Job job);
+
+    [[nodiscard]] std::size_t pending() const;
+
+private:
+    const std::size_t threads;
+    unit::bounded_queue<Job> queue;
+    std::vector<std::thread> workers;
+
+    void work();
+};
+
+
+#endif //UVM_STORAGEWORKERS_H
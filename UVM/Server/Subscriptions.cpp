@@ -0,0 +1,175 @@
+#include "Subscriptions.h"
+#include "algorithm"
+#include "unordered_set"
+#include "boost/json.hpp"
+
+void Subscriptions::subscribe_blocks(const std::shared_ptr<Subscriber> &subscriber) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    add(this->blocks, subscriber);
+}
+
+void Subscriptions::subscribe_tx(const unit::Hash32 &hash, const std::shared_ptr<Subscriber> &subscriber) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    add(this->transactions[hash], subscriber);
+}
+
+void Subscriptions::subscribe_address(const std::string &address, const std::shared_ptr<Subscriber> &subscriber) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    add(this->addresses[address], subscriber);
+}
+
+void Subscriptions::unsubscribe(const Subscriber *subscriber, const Topics &topics) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (topics.blocks)
+        remove(this->blocks, subscriber);
+    for (const unit::Hash32 &hash : topics.transactions) {
+        auto found = this->transactions.find(hash);
+        if (found == this->transactions.end())
+            continue;
+        remove(found->second, subscriber);
+        if (found->second.empty())
+            this->transactions.erase(found);
+    }
+    for (const std::string &address : topics.addresses) {
+        auto found = this->addresses.find(address);
+        if (found == this->addresses.end())
+            continue;
+        remove(found->second, subscriber);
+        if (found->second.empty())
+            this->addresses.erase(found);
+    }
+}
+
+void Subscriptions::block_committed(const Block &block, const std::vector<unit::Hash32> &taken) {
+    std::vector<std::shared_ptr<Subscriber>> receivers;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        collect(this->blocks, receivers);
+    }
+    if (!receivers.empty()) {
+        boost::json::object event;
+        event["event"] = "newBlock";
+        event["index"] = block.getIndex();
+        event["hash"] = block.getHash().to_hex();
+        event["prev_hash"] = block.getPrevHash().to_hex();
+        event["date"] = block.getDate();
+        event["transactions"] = block.transactions.size();
+        send(receivers, boost::json::serialize(event));
+    }
+
+    std::unordered_set<unit::Hash32> executed;
+    executed.reserve(block.transactions.size());
+    for (const Transaction &transaction : block.transactions)
+        executed.insert(transaction.hash);
+    for (const unit::Hash32 &hash : taken) {
+        receivers.clear();
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            auto found = this->transactions.find(hash);
+            if (found == this->transactions.end())
+                continue;
+            collect(found->second, receivers);
+            this->transactions.erase(found); // the status is final, subscriptions are fired once
+        }
+        if (executed.count(hash))
+            send_status(receivers, hash, tx_status(hash, "committed", block.getIndex(), block.getHash()));
+        else
+            send_status(receivers, hash, tx_status(hash, "rejected", block.getIndex(), block.getHash()));
+    }
+
+    for (const Transaction &transaction : block.transactions) {
+        for (const std::string *address : {&transaction.from, &transaction.to}) {
+            if (address->empty() || (address == &transaction.to && transaction.to == transaction.from))
+                continue;
+            receivers.clear();
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                auto found = this->addresses.find(*address);
+                if (found == this->addresses.end())
+                    continue;
+                collect(found->second, receivers);
+            }
+            boost::json::object event;
+            event["event"] = "addressActivity";
+            event["address"] = *address;
+            event["hash"] = transaction.hash.to_hex();
+            event["from"] = transaction.from;
+            event["to"] = transaction.to;
+            event["type"] = transaction.type;
+            event["amount"] = transaction.amount;
+            event["block_index"] = block.getIndex();
+            event["block_hash"] = block.getHash().to_hex();
+            send(receivers, boost::json::serialize(event));
+        }
+    }
+}
+
+void Subscriptions::block_failed(const std::vector<unit::Hash32> &taken) {
+    std::vector<std::shared_ptr<Subscriber>> receivers;
+    for (const unit::Hash32 &hash : taken) {
+        receivers.clear();
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            auto found = this->transactions.find(hash);
+            if (found == this->transactions.end())
+                continue;
+            collect(found->second, receivers);
+            this->transactions.erase(found);
+        }
+        send_status(receivers, hash, tx_status(hash, "rejected", 0, unit::Hash32()));
+    }
+}
+
+std::string Subscriptions::tx_status(const unit::Hash32 &hash, const char *status, uint64_t block_index, const unit::Hash32 &block_hash) {
+    boost::json::object event;
+    event["event"] = "txStatus";
+    event["hash"] = hash.to_hex();
+    event["status"] = status;
+    if (!block_hash.is_zero()) {
+        event["block_index"] = block_index;
+        event["block_hash"] = block_hash.to_hex();
+    }
+    return boost::json::serialize(event);
+}
+
+void Subscriptions::add(List &list, const std::shared_ptr<Subscriber> &subscriber) {
+    for (const std::weak_ptr<Subscriber> &existing : list)
+        if (existing.lock() == subscriber)
+            return;
+    list.push_back(subscriber);
+}
+
+void Subscriptions::remove(List &list, const Subscriber *subscriber) {
+    list.erase(std::remove_if(list.begin(), list.end(), [subscriber](const std::weak_ptr<Subscriber> &existing) {
+        std::shared_ptr<Subscriber> alive = existing.lock();
+        return !alive || alive.get() == subscriber;
+    }), list.end());
+}
+
+void Subscriptions::collect(List &list, std::vector<std::shared_ptr<Subscriber>> &out) {
+    std::size_t kept = 0;
+    for (std::weak_ptr<Subscriber> &existing : list) {
+        std::shared_ptr<Subscriber> alive = existing.lock();
+        if (!alive)
+            continue;
+        out.push_back(std::move(alive));
+        list[kept++] = std::move(existing);
+    }
+    list.resize(kept);
+}
+
+void Subscriptions::send(const std::vector<std::shared_ptr<Subscriber>> &subscribers, const std::string &message) {
+    if (subscribers.empty())
+        return;
+    auto shared = std::make_shared<const std::string>(message);
+    for (const std::shared_ptr<Subscriber> &subscriber : subscribers)
+        subscriber->deliver(shared);
+}
+
+void Subscriptions::send_status(const std::vector<std::shared_ptr<Subscriber>> &subscribers, const unit::Hash32 &hash, const std::string &message) {
+    if (subscribers.empty())
+        return;
+    auto shared = std::make_shared<const std::string>(message);
+    for (const std::shared_ptr<Subscriber> &subscriber : subscribers)
+        subscriber->deliver_status(hash, shared);
+}
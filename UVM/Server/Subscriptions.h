@@ -0,0 +1,71 @@
+#ifndef UVM_SUBSCRIPTIONS_H
+#define UVM_SUBSCRIPTIONS_H
+#include "memory"
+#include "mutex"
+#include "string"
+#include "unordered_map"
+#include "vector"
+#include "../Blockchain_core/Block.h"
+#include "../Blockchain_core/Hash32.h"
+
+#define WS_SEND_QUEUE 256 // messages waiting to be sent to a subscriber before it is disconnected as too slow
+#define WS_MAX_SUBSCRIPTIONS 1024 // per connection
+#define WS_MAX_MESSAGE 4096 // bytes of a message from a subscriber
+
+// Events of the block commit path pushed to WebSocket subscribers instead of being polled for:
+//   newBlocks               every committed block
+//   txStatus(hash)          the transaction was committed or rejected by block execution, fired once
+//   addressActivity(addr)   a committed transaction sent from or to the address
+// The commit thread only serializes every event once and hands it to the subscribers, which queue it without
+// blocking; a subscriber that cannot keep up is disconnected instead of slowing down the commit path.
+class Subscriptions {
+public:
+    // receiving end of subscriptions, a WebSocket session
+    class Subscriber {
+    public:
+        virtual ~Subscriber() = default;
+        // called from the commit thread, must not block
+        virtual void deliver(const std::shared_ptr<const std::string> &message) = 0;
+        // txStatus of hash, also raised by the subscriber's own lookup of an earlier commit; reported once per subscription
+        virtual void deliver_status(const unit::Hash32 &hash, const std::shared_ptr<const std::string> &message) = 0;
+    };
+
+    // what a subscriber is subscribed to, kept by the subscriber to unsubscribe when it goes away
+    struct Topics {
+        bool blocks = false;
+        std::vector<unit::Hash32> transactions;
+        std::vector<std::string> addresses;
+
+        [[nodiscard]] std::size_t size() const { return blocks + transactions.size() + addresses.size(); }
+    };
+
+    void subscribe_blocks(const std::shared_ptr<Subscriber> &subscriber);
+    void subscribe_tx(const unit::Hash32 &hash, const std::shared_ptr<Subscriber> &subscriber);
+    void subscribe_address(const std::string &address, const std::shared_ptr<Subscriber> &subscriber);
+    void unsubscribe(const Subscriber *subscriber, const Topics &topics);
+
+    // block with its executed transactions, taken lists every transaction taken from the mempool for it
+    void block_committed(const Block &block, const std::vector<unit::Hash32> &taken);
+    // the block could not be executed, none of its transactions made it
+    void block_failed(const std::vector<unit::Hash32> &taken);
+
+    static std::string tx_status(const unit::Hash32 &hash, const char *status, uint64_t block_index, const unit::Hash32 &block_hash);
+
+private:
+    typedef std::vector<std::weak_ptr<Subscriber>> List;
+
+    std::mutex mutex;
+    List blocks;
+    std::unordered_map<unit::Hash32, List> transactions;
+    std::unordered_map<std::string, List> addresses;
+
+    static void add(List &list, const std::shared_ptr<Subscriber> &subscriber);
+    static void remove(List &list, const Subscriber *subscriber);
+    // live subscribers of list, expired ones are dropped on the way
+    static void collect(List &list, std::vector<std::shared_ptr<Subscriber>> &out);
+    static void send(const std::vector<std::shared_ptr<Subscriber>> &subscribers, const std::string &message);
+    static void send_status(const std::vector<std::shared_ptr<Subscriber>> &subscribers, const unit::Hash32 &hash, const std::string &message);
+};
+
+
+#endif //UVM_SUBSCRIPTIONS_H
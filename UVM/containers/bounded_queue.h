@@ -0,0 +1,94 @@
+#ifndef UVM_BOUNDED_QUEUE_H
+#define UVM_BOUNDED_QUEUE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+// Bounded blocking multi-producer/multi-consumer queue, used between worker pools.
+// push() blocks while the queue is full, which propagates backpressure to the previous stage;
+// try_push() is for the entry point, where a full queue is reported to the caller instead.
+
+namespace unit {
+    template <class T>
+    class bounded_queue {
+    public:
+        typedef T value_type;
+        typedef std::size_t size_type;
+
+        explicit bounded_queue(size_type capacity) : max_size(capacity == 0 ? 1 : capacity) {}
+
+        bounded_queue(const bounded_queue &) = delete;
+        bounded_queue &operator=(const bounded_queue &) = delete;
+
+        // Returns false when the queue is full or closed, in that case value is left untouched.
+        bool try_push(T &&value) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (closed || items.size() >= max_size)
+                    return false;
+                items.push_back(std::move(value));
+                count.store(items.size(), std::memory_order_relaxed);
+            }
+            not_empty.notify_one();
+            return true;
+        }
+
+        // Blocks while the queue is full. Returns false when the queue was closed.
+        bool push(T &&value) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                not_full.wait(lock, [this] { return closed || items.size() < max_size; });
+                if (closed)
+                    return false;
+                items.push_back(std::move(value));
+                count.store(items.size(), std::memory_order_relaxed);
+            }
+            not_empty.notify_one();
+            return true;
+        }
+
+        // Blocks while the queue is empty. Returns false once the queue is closed and drained.
+        bool pop(T &value) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                not_empty.wait(lock, [this] { return closed || !items.empty(); });
+                if (items.empty())
+                    return false;
+                value = std::move(items.front());
+                items.pop_front();
+                count.store(items.size(), std::memory_order_relaxed);
+            }
+            not_full.notify_one();
+            return true;
+        }
+
+        // Wakes up every waiting thread, nothing can be pushed afterwards.
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closed = true;
+            }
+            not_empty.notify_all();
+            not_full.notify_all();
+        }
+
+        // Approximate number of queued elements, may be read without the lock.
+        [[nodiscard]] size_type size() const { return count.load(std::memory_order_relaxed); }
+        [[nodiscard]] size_type capacity() const { return max_size; }
+
+    private:
+        const size_type max_size;
+        std::deque<T> items;
+        std::mutex mutex;
+        std::condition_variable not_empty;
+        std::condition_variable not_full;
+        std::atomic<size_type> count{0};
+        bool closed = false;
+    };
+}
+
+#endif //UVM_BOUNDED_QUEUE_H
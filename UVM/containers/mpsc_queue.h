@@ -0,0 +1,127 @@
+#ifndef UVM_MPSC_QUEUE_H
+#define UVM_MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bounded lock-free multi-producer/single-consumer ring buffer.
+// Every cell carries a sequence number (D. Vyukov's bounded queue): producers claim a slot with a CAS on
+// enqueue_pos and publish it by bumping the cell sequence, the single consumer never needs a CAS.
+// Elements are moved in and moved out, so move-only types are supported.
+
+namespace unit {
+    template <class T>
+    class mpsc_queue {
+    public:
+        typedef T value_type;
+        typedef std::size_t size_type;
+
+        // capacity is rounded up to the next power of two
+        explicit mpsc_queue(size_type capacity) : mask(round_up(capacity) - 1), cells(new cell[mask + 1]) {
+            for (size_type i = 0; i <= mask; ++i)
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        mpsc_queue(const mpsc_queue &) = delete;
+        mpsc_queue &operator=(const mpsc_queue &) = delete;
+
+        ~mpsc_queue() {
+            for (;;) {
+                cell *c = &cells[dequeue_pos & mask];
+                if (c->sequence.load(std::memory_order_acquire) != dequeue_pos + 1)
+                    break;
+                std::launder(reinterpret_cast<T *>(&c->storage))->~T();
+                ++dequeue_pos;
+            }
+            delete[] cells;
+        }
+
+        // Producer side, safe to call from any number of threads. Returns false when the queue is full,
+        // in that case value is left untouched.
+        bool try_push(T &&value) {
+            cell *c;
+            size_type pos = enqueue_pos.load(std::memory_order_relaxed);
+            for (;;) {
+                c = &cells[pos & mask];
+                size_type seq = c->sequence.load(std::memory_order_acquire);
+                auto diff = (std::ptrdiff_t) seq - (std::ptrdiff_t) pos;
+                if (diff == 0) {
+                    if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = enqueue_pos.load(std::memory_order_relaxed);
+                }
+            }
+            new (&c->storage) T(std::move(value));
+            count.fetch_add(1, std::memory_order_relaxed); // before publishing, so the consumer never takes it below 0
+            c->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side, must be called from a single thread only.
+        bool try_pop(T &value) {
+            cell *c = &cells[dequeue_pos & mask];
+            size_type seq = c->sequence.load(std::memory_order_acquire);
+            if ((std::ptrdiff_t) seq - (std::ptrdiff_t) (dequeue_pos + 1) < 0)
+                return false;
+            T *stored = std::launder(reinterpret_cast<T *>(&c->storage));
+            value = std::move(*stored);
+            stored->~T();
+            c->sequence.store(dequeue_pos + mask + 1, std::memory_order_release);
+            ++dequeue_pos;
+            count.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // Consumer side: moves up to max elements to the back of out, returns how many were taken.
+        size_type pop_batch(std::vector<T> &out, size_type max) {
+            size_type taken = 0;
+            for (; taken < max; ++taken) {
+                cell *c = &cells[dequeue_pos & mask];
+                size_type seq = c->sequence.load(std::memory_order_acquire);
+                if ((std::ptrdiff_t) seq - (std::ptrdiff_t) (dequeue_pos + 1) < 0)
+                    break;
+                T *stored = std::launder(reinterpret_cast<T *>(&c->storage));
+                out.emplace_back(std::move(*stored));
+                stored->~T();
+                c->sequence.store(dequeue_pos + mask + 1, std::memory_order_release);
+                ++dequeue_pos;
+            }
+            if (taken)
+                count.fetch_sub(taken, std::memory_order_relaxed);
+            return taken;
+        }
+
+        // Approximate number of queued elements; lock-free, may be read from any thread.
+        [[nodiscard]] size_type size() const { return count.load(std::memory_order_relaxed); }
+        [[nodiscard]] bool empty() const { return size() == 0; }
+        [[nodiscard]] size_type capacity() const { return mask + 1; }
+
+    private:
+        struct cell {
+            std::atomic<size_type> sequence;
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        };
+
+        static size_type round_up(size_type n) {
+            size_type v = 2;
+            while (v < n)
+                v <<= 1;
+            return v;
+        }
+
+        const size_type mask;
+        cell *const cells;
+        alignas(64) std::atomic<size_type> enqueue_pos{0};
+        alignas(64) size_type dequeue_pos = 0; // owned by the consumer
+        alignas(64) std::atomic<size_type> count{0};
+    };
+}
+
+#endif //UVM_MPSC_QUEUE_H
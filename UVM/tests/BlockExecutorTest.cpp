@@ -0,0 +1,169 @@
+// Block executor checks, run by ctest. Transactions are executed against an in-memory state instead of RocksDB.
+
+#include "iostream"
+#include "string"
+#include "unordered_map"
+#include "vector"
+#include "boost/json/src.hpp"
+#include "../Blockchain_core/DB/BlockExecutor.h"
+#include "../Blockchain_core/DB/DB.h"
+#include "../Blockchain_core/Wallet/WalletAccount.h"
+
+#define TOKEN_BYTECODE "7B226E616D65223A226C6162222C22737570706C79223A3130307D" // {"name":"lab","supply":100}
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::cout << "Error: " << __FILE__ << ":" << __LINE__ << ": " << #condition << std::endl; \
+            ++failures; \
+        } \
+    } while (false)
+
+// state before the block: accounts with the given unit balances
+static unit::StorageReader state_of(const std::vector<std::pair<std::string, double>> &balances) {
+    std::unordered_map<std::string, std::string> accounts;
+    for (const auto &[address, amount] : balances)
+        accounts[address] = WalletAccount(address, amount, {}).to_json_string();
+    return [accounts](int column, const std::string &key, std::string *value) {
+        if (column != CF_ACCOUNTS)
+            return false;
+        auto found = accounts.find(key);
+        if (found == accounts.end())
+            return false;
+        *value = found->second;
+        return true;
+    };
+}
+
+static unit::StorageReader state_with(const std::string &address, double amount) {
+    return state_of({{address, amount}});
+}
+
+static Transaction transfer(const std::string &from, const std::string &to, double amount, uint64_t nonce) {
+    Transaction transaction(from, to, UNIT_TRANSFER, 1, unit::TxPayload(), "0", amount); // fixed date, same hash every time
+    transaction.setFee(0.01 * SUBUNITS_PER_UNIT);
+    transaction.setNonce(nonce);
+    transaction.generate_tx_hash();
+    return transaction;
+}
+
+static Transaction create_token(const std::string &from, double fee, uint64_t nonce = 0) {
+    unit::TxPayload payload;
+    payload.set(unit::TxPayload::BYTECODE, TOKEN_BYTECODE);
+    Transaction transaction(from, "", CREATE_TOKEN, std::move(payload), "0", 0);
+    transaction.setFee(fee);
+    transaction.setNonce(nonce);
+    return transaction;
+}
+
+static bool writes_column(const unit::BlockExecutor::Result &result, int column) {
+    for (const auto &[key, value] : result.writes)
+        if (unit::BlockExecutor::state_column(key) == column)
+            return true;
+    return false;
+}
+
+// a creator that cannot pay the fee gets no token, and the name stays free
+static void underfunded_token_creation_leaves_no_token() {
+    unit::BlockExecutor executor(1);
+    std::vector<Transaction> transactions;
+    transactions.push_back(create_token("poor", 10 * SUBUNITS_PER_UNIT));
+    unit::BlockExecutor::Result result = executor.execute(transactions, 2, state_with("poor", 1));
+    CHECK(!result.invalid);
+    CHECK(result.accepted.size() == 1 && !result.accepted[0]);
+    CHECK(!writes_column(result, CF_TOKENS));
+    CHECK(result.writes.empty());
+}
+
+static void funded_token_creation_writes_token() {
+    unit::BlockExecutor executor(1);
+    std::vector<Transaction> transactions;
+    transactions.push_back(create_token("rich", 10 * SUBUNITS_PER_UNIT));
+    unit::BlockExecutor::Result result = executor.execute(transactions, 2, state_with("rich", 100));
+    CHECK(result.accepted.size() == 1 && result.accepted[0]);
+    CHECK(writes_column(result, CF_TOKENS));
+}
+
+// the second token of the same name is refused instead of overwriting the first
+static void duplicate_token_name_is_rejected() {
+    unit::BlockExecutor executor(1);
+    std::vector<Transaction> transactions;
+    transactions.push_back(create_token("rich", 10 * SUBUNITS_PER_UNIT, 0));
+    transactions.push_back(create_token("rich", 10 * SUBUNITS_PER_UNIT, 1));
+    unit::BlockExecutor::Result result = executor.execute(transactions, 2, state_with("rich", 100));
+    CHECK(result.accepted.size() == 2 && result.accepted[0] && !result.accepted[1]);
+}
+
+static boost::json::object account_after(const unit::BlockExecutor::Result &result, const std::string &address) {
+    auto found = result.writes.find(unit::BlockExecutor::state_key(CF_ACCOUNTS, address));
+    if (found == result.writes.end())
+        return {};
+    return boost::json::parse(found->second).as_object();
+}
+
+// sending to oneself only costs the fee, the amount is neither created nor lost
+static void self_transfer_pays_the_fee_only() {
+    unit::BlockExecutor executor(1);
+    std::vector<Transaction> transactions;
+    transactions.push_back(transfer("self", "self", 10, 0));
+    unit::BlockExecutor::Result result = executor.execute(transactions, 2, state_with("self", 100));
+    CHECK(result.accepted.size() == 1 && result.accepted[0]);
+    boost::json::object account = account_after(result, "self");
+    CHECK(account.contains("amount") && boost::json::value_to<double>(account["amount"]) == 100 - 0.01 * SUBUNITS_PER_UNIT / SUBUNITS_PER_UNIT);
+    CHECK(account.contains("nonce") && boost::json::value_to<uint64_t>(account["nonce"]) == 1);
+    CHECK(account.contains("inputs") && account["inputs"].as_array().size() == 1);
+    CHECK(account.contains("outputs") && account["outputs"].as_array().size() == 1);
+}
+
+// chained transfers: every one reads what an earlier one wrote, one sender sends with consecutive nonces
+static std::vector<Transaction> conflicting_block() {
+    std::vector<Transaction> transactions;
+    transactions.push_back(transfer("a", "b", 10, 0));
+    transactions.push_back(transfer("b", "c", 5, 0)); // b only has the 10 from above
+    transactions.push_back(transfer("a", "c", 1, 1));
+    transactions.push_back(transfer("c", "a", 2, 0)); // c only has what it got above
+    transactions.push_back(transfer("a", "b", 1, 2));
+    transactions.push_back(transfer("b", "a", 3, 1));
+    transactions.push_back(transfer("d", "e", 4, 0)); // independent of the rest
+    transactions.push_back(transfer("c", "b", 1, 1));
+    transactions.push_back(transfer("a", "b", 200, 3)); // more than a has
+    transactions.push_back(transfer("b", "c", 1, 3)); // nonce gap
+    transactions.push_back(transfer("b", "c", 1, 2));
+    return transactions;
+}
+
+// the speculative run must end exactly where applying the transactions one by one does
+static void parallel_execution_matches_sequential() {
+    std::vector<std::pair<std::string, double>> balances = {{"a", 100}, {"b", 0}, {"c", 0}, {"d", 50}};
+    std::vector<Transaction> sequential_block = conflicting_block();
+    std::vector<Transaction> parallel_block = conflicting_block();
+    CHECK(parallel_block.size() >= EXECUTOR_MIN_PARALLEL_TXS);
+
+    unit::BlockExecutor sequential_executor(1);
+    unit::BlockExecutor parallel_executor(4);
+    unit::BlockExecutor::Result sequential = sequential_executor.execute(sequential_block, 2, state_of(balances));
+    unit::BlockExecutor::Result parallel = parallel_executor.execute(parallel_block, 2, state_of(balances));
+
+    CHECK(!sequential.invalid && !parallel.invalid);
+    CHECK(sequential.reexecuted == 0);
+    CHECK(parallel.reexecuted > 0); // the chain cannot all be kept from the speculative run
+    CHECK(parallel.accepted == sequential.accepted);
+    CHECK(parallel.writes == sequential.writes);
+    CHECK(sequential.accepted.size() == 11 && !sequential.accepted[8] && !sequential.accepted[9] && sequential.accepted[10]);
+}
+
+int main() {
+    underfunded_token_creation_leaves_no_token();
+    funded_token_creation_writes_token();
+    duplicate_token_name_is_rejected();
+    self_transfer_pays_the_fee_only();
+    parallel_execution_matches_sequential();
+    if (failures != 0) {
+        std::cout << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "BlockExecutor: all checks passed" << std::endl;
+    return 0;
+}